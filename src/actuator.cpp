@@ -0,0 +1,77 @@
+#include "actuator.hpp"
+
+Actuator::Actuator(std::function<void(float)> write)
+	: write(std::move(write))
+{
+	thread = std::thread(&Actuator::run, this);
+}
+
+Actuator::~Actuator()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	thread.join();
+}
+
+void Actuator::submit(float value)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (hasPending)
+			coalescedCount++;
+		pending = value;
+		hasPending = true;
+		submittedCount++;
+	}
+	wake.notify_one();
+}
+
+bool Actuator::idle() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return !hasPending && !writing;
+}
+
+uint64_t Actuator::submitted() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return submittedCount;
+}
+
+uint64_t Actuator::written() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return writtenCount;
+}
+
+uint64_t Actuator::coalesced() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return coalescedCount;
+}
+
+void Actuator::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this] { return hasPending || stopping; });
+		if (!hasPending)
+			return;
+
+		float value = pending;
+		hasPending = false;
+		writing = true;
+
+		// The write happens without the lock, so submit() never waits for it
+		lock.unlock();
+		write(value);
+		lock.lock();
+
+		writing = false;
+		writtenCount++;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Applies values on its own thread, so that slow writes (e.g. an IPC
+// round-trip) never hold up the caller. Values submitted while a write is in
+// flight replace each other: only the latest one gets written next.
+class Actuator
+{
+public:
+	explicit Actuator(std::function<void(float)> write);
+	// Writes what is still pending, then stops
+	~Actuator();
+	Actuator(const Actuator &) = delete;
+	Actuator &operator=(const Actuator &) = delete;
+
+	void submit(float value);
+
+	// Nothing pending or being written
+	bool idle() const;
+
+	uint64_t submitted() const;
+	uint64_t written() const;
+	// Values replaced by a later one before they were written
+	uint64_t coalesced() const;
+
+private:
+	void run();
+
+	std::function<void(float)> write;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	float pending = 0.0f;
+	bool hasPending = false;
+	bool writing = false;
+	bool stopping = false;
+	uint64_t submittedCount = 0;
+	uint64_t writtenCount = 0;
+	uint64_t coalescedCount = 0;
+	std::thread thread;
+};
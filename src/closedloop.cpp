@@ -0,0 +1,205 @@
+#include "closedloop.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "ingest.hpp"
+#include "scheduler.hpp"
+
+// How close to the ideal resolution counts as having converged
+static constexpr double convergedBand = 0.10;
+
+ClosedLoopResult runClosedLoop(const ControllerConfig &config, const SimConfig &simConfig, double durationS)
+{
+	auto wallStart = std::chrono::steady_clock::now();
+
+	ClosedLoopResult result;
+	SimRuntime sim(simConfig);
+	sim.setSupersampleScale(config.initialRes);
+	FrameIngest ingest(sim);
+	ResolutionController controller(config);
+	PollScheduler scheduler(config);
+
+	uint64_t missedFrames = 0;
+	double resSum = 0.0;
+	int lastDirection = 0;
+	// Latest step of the resolution, made by the controller or the simulated user
+	float lastRes = sim.getSupersampleScale();
+	long lastStepMs = 0;
+	int lastStepDirection = 0;
+
+	// Convergence tracking for the current phase
+	size_t phase = sim.phaseNumber();
+	double phaseStartS = 0.0;
+	bool converged = false;
+	double convergenceSum = 0.0;
+	uint32_t phases = 0;
+
+	long delay = 0;
+	while (sim.nowMs() < durationS * 1000.0)
+	{
+		sim.advance(double(delay));
+
+		ControllerInput input;
+		input.timeMs = long(sim.nowMs());
+		input.currentRes = sim.getSupersampleScale();
+		input.displayHz = sim.getDisplayFrequency();
+		input.dashboardVisible = sim.isDashboardVisible();
+		input.basePixels = basePixelsFor(sim, input.currentRes);
+
+		if (input.currentRes != lastRes)
+		{
+			lastStepMs = input.timeMs;
+			lastStepDirection = input.currentRes > lastRes ? 1 : -1;
+		}
+
+		ingest.poll();
+		for (uint32_t i = 0; i < ingest.count(); i++)
+		{
+			if (ingest.frames()[i].numFramePresents > 1)
+				missedFrames++;
+			resSum += input.currentRes;
+		}
+		result.frames += ingest.count();
+
+		Decision decision = controller.update(input, ingest.frames(), ingest.count());
+		result.ticks++;
+		if (decision.changed)
+		{
+			int direction = decision.newRes > input.currentRes ? 1 : -1;
+			if (lastDirection != 0 && direction != lastDirection)
+				result.oscillations++;
+			lastDirection = direction;
+			result.changes++;
+			if (decision.action == Action::PredictedDecrease && lastStepDirection < 0 && input.timeMs - lastStepMs <= 2 * config.resChangeDelayMs)
+				result.chainedPredictions++;
+			lastStepMs = input.timeMs;
+			lastStepDirection = direction;
+			sim.setSupersampleScale(decision.newRes);
+		}
+
+		// Where the resolution should settle for the current load
+		double nowS = sim.nowMs() / 1000.0;
+		if (sim.phaseNumber() != phase)
+		{
+			if (!converged)
+			{
+				convergenceSum += nowS - phaseStartS;
+				phases++;
+			}
+			phase = sim.phaseNumber();
+			phaseStartS = nowS;
+			converged = false;
+		}
+		float targetGpuTime = controller.targetFrametime() * (config.resIncreaseThreshold + config.resDecreaseThreshold) / 2;
+		double ideal = std::clamp(sim.resolutionFor(targetGpuTime), config.minRes, config.maxRes);
+		double error = (sim.getSupersampleScale() - ideal) / ideal;
+		if (!converged && std::abs(error) <= convergedBand)
+		{
+			converged = true;
+			convergenceSum += nowS - phaseStartS;
+			phases++;
+		}
+		else if (converged)
+		{
+			result.overshoot = std::max(result.overshoot, error);
+		}
+
+		lastRes = sim.getSupersampleScale();
+		delay = scheduler.next(controller, input.timeMs, sim.getSupersampleScale(), input.displayHz, input.dashboardVisible, sim.getSceneProcessId() != 0);
+	}
+	if (!converged)
+	{
+		convergenceSum += sim.nowMs() / 1000.0 - phaseStartS;
+		phases++;
+	}
+
+	if (result.frames > 0)
+	{
+		result.missedFrameRatio = double(missedFrames) / result.frames;
+		result.averageRes = resSum / result.frames;
+	}
+	if (phases > 0)
+		result.timeToTargetS = convergenceSum / phases;
+	result.skippedChanges = controller.skippedChanges();
+	result.hitchFrames = controller.hitches().estimate().missedFrames;
+	result.predictions = controller.predictionsFired();
+	result.confirmedPredictions = controller.predictionsConfirmed();
+	result.rateModeSwitches = controller.rateModes().switches();
+	result.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+	return result;
+}
+
+const std::vector<std::string> &simScenarioNames()
+{
+	static const std::vector<std::string> names = {"steady", "bursty", "scene-change", "ramp", "manual-step", "cpu-bound"};
+	return names;
+}
+
+bool simScenario(const std::string &name, float refreshHz, SimConfig &sim)
+{
+	sim = SimConfig();
+	sim.refreshHz = refreshHz;
+	sim.appKey = "sim." + name;
+
+	// Loads are relative to the refresh rate, so that 100% resolution sits
+	// slightly under the default thresholds whatever the headset
+	float frametime = 1000.0f / refreshHz;
+	sim.gpuMs = frametime * 0.72f;
+	sim.cpuMs = frametime * 0.45f;
+
+	if (name == "steady")
+	{
+		// Defaults
+	}
+	else if (name == "bursty")
+	{
+		sim.noise = 0.12f;
+		sim.spikeChance = 0.02f;
+		sim.spikeMs = frametime * 0.7f;
+	}
+	else if (name == "scene-change")
+	{
+		sim.phases = {
+			{30.0, 1.0f, sim.cpuMs},
+			{30.0, 1.8f, sim.cpuMs},
+			{30.0, 0.6f, sim.cpuMs},
+			{30.0, 1.3f, sim.cpuMs},
+		};
+	}
+	else if (name == "ramp")
+	{
+		// Load building up over a few seconds, like a scene filling with effects
+		sim.phases = {
+			{20.0, 0.9f, sim.cpuMs, 0.0},
+			{25.0, 1.7f, sim.cpuMs, 8.0},
+			{20.0, 1.0f, sim.cpuMs, 4.0},
+			{25.0, 2.2f, sim.cpuMs, 12.0},
+		};
+	}
+	else if (name == "manual-step")
+	{
+		// Constant load, the user moving the resolution slider now and then. A large share of the
+		// frame doesn't scale with the resolution, so the frametime per unit of resolution steps with it.
+		sim.gpuFixedMs = sim.gpuMs * 0.4f;
+		sim.phases = {
+			{30.0, 1.0f, sim.cpuMs},
+			{30.0, 1.0f, sim.cpuMs, 0.0, 0.6f},
+			{30.0, 1.0f, sim.cpuMs, 0.0, 1.6f},
+		};
+	}
+	else if (name == "cpu-bound")
+	{
+		sim.phases = {
+			{40.0, 1.0f, sim.cpuMs},
+			{40.0, 1.0f, frametime * 1.2f},
+			{40.0, 1.0f, frametime * 2.3f},
+		};
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "controller.hpp"
+#include "simruntime.hpp"
+
+// How well the controller drove the simulated runtime
+struct ClosedLoopResult
+{
+	uint64_t frames = 0;
+	uint32_t ticks = 0;
+	// Frames shown more than once, over all frames
+	double missedFrameRatio = 0.0;
+	double averageRes = 0.0;
+	uint32_t changes = 0;
+	// Resolution changes that went the other way from the previous one
+	uint32_t oscillations = 0;
+	// Mean time from the start of a phase until the resolution got within 10% of
+	// the ideal one (phases where it never did count as the whole phase)
+	double timeToTargetS = 0.0;
+	// Largest relative overshoot above the ideal resolution once it was reached
+	double overshoot = 0.0;
+	// Increases skipped because of their hitch cost
+	uint64_t skippedChanges = 0;
+	// Frames a change was estimated to miss at the end of the run
+	double hitchFrames = 0.0;
+	// Early decreases from the frametime trend, and how many were followed by the predicted rise
+	uint64_t predictions = 0;
+	uint64_t confirmedPredictions = 0;
+	// Early decreases right after a step down (ours or the user's), which the step
+	// itself would cause if it were mistaken for a rising frametime
+	uint64_t chainedPredictions = 0;
+	// Switches between native and half rate
+	uint64_t rateModeSwitches = 0;
+	// Wall-clock time the run took
+	double wallMs = 0.0;
+};
+
+// Drives the controller against a SimRuntime for durationS simulated seconds,
+// the same way the main loop drives it against SteamVR
+ClosedLoopResult runClosedLoop(const ControllerConfig &config, const SimConfig &sim, double durationS);
+
+// Built-in workloads: steady, bursty, scene-change, ramp, manual-step and cpu-bound
+const std::vector<std::string> &simScenarioNames();
+bool simScenario(const std::string &name, float refreshHz, SimConfig &sim);
@@ -0,0 +1,453 @@
+#include "controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Upper bound on the share of GPU frametime treated as independent of resolution
+static constexpr double maxFixedShare = 0.9;
+
+// The application counts as CPU-bound when at least this share of the recent frames
+// was reprojected for being late on the CPU, and few of them for the GPU
+static constexpr float cpuBoundShare = 0.5f;
+static constexpr float cpuBoundMaxGpuShare = 0.1f;
+
+// Frames the spike check needs before trusting the median, how many times the median a spike
+// takes, and how many outliers in a row are dropped before they count as the new normal
+static constexpr size_t outlierMinSamples = 32;
+static constexpr float outlierSpikeFactor = 4.0f;
+static constexpr uint32_t outlierMaxRun = 8;
+
+static constexpr size_t inApp = size_t(SessionState::InApp);
+
+// Pixels per unit of supersample scale; without a render target size the model works in resolution units
+static double pixelsAtFullRes(const ControllerInput &input)
+{
+	return input.basePixels > 0 ? input.basePixels : 1.0;
+}
+
+const char *actionName(Action action)
+{
+	switch (action)
+	{
+	case Action::Increase:
+		return "increase";
+	case Action::Decrease:
+		return "decrease";
+	case Action::VramDecrease:
+		return "vram-decrease";
+	case Action::VramRestore:
+		return "vram-restore";
+	case Action::Reset:
+		return "reset";
+	case Action::PredictedDecrease:
+		return "predicted-decrease";
+	case Action::ThrottleDecrease:
+		return "throttle-decrease";
+	default:
+		return "none";
+	}
+}
+
+ResolutionController::ResolutionController(const ControllerConfig &config)
+	: cfg(config),
+	  gpuTimes(sessionStateCount, FrametimeStats(config.dataWindowSamples, config.dataAverageSamples)),
+	  cpuTimes(sessionStateCount, FrametimeStats(config.dataWindowSamples, config.dataAverageSamples)),
+	  rawCpuTimes(config.dataWindowSamples, config.dataAverageSamples),
+	  pipeline(config.dataWindowSamples, config.dataAverageSamples),
+	  costModel(config.dataAverageSamples),
+	  reprojection(config.dataAverageSamples)
+{
+}
+
+Decision ResolutionController::update(const ControllerInput &input, const FrameSample *frames, uint32_t count)
+{
+	Decision decision;
+	decision.newRes = input.currentRes;
+
+	if (!started)
+	{
+		// Don't change anything until a full resChangeDelayMs has passed
+		started = true;
+		lastChange = input.timeMs;
+	}
+	if (input.displayHz <= 0)
+		return decision;
+
+	// On-time frames are shown twice while reprojecting on purpose
+	uint32_t expectedPresents = target > realTarget ? 2 : 1;
+
+	realTarget = 1000 / input.displayHz;
+	target = realTarget;
+
+	// A transition ending is like a reset: decisions wait for a full resChangeDelayMs of new frames
+	if (session.update(input.timeMs, input.dashboardVisible))
+		lastChange = input.timeMs;
+	report.addTime(input.timeMs, session.state(), input.currentRes);
+	report.addVram(input.vramUsage);
+
+	// Frames since the last tick were rendered at the current resolution
+	double pixels = input.currentRes * pixelsAtFullRes(input);
+
+	// Only part of the frametime follows the resolution, so the trend starts over at each
+	// resolution (ours or the user's) instead of reading the step as a rise or a fall
+	if (input.currentRes != trendRes)
+	{
+		gpuTrend.clear();
+		trendRes = input.currentRes;
+	}
+
+	// Spikes are measured against the median before this tick's frames
+	float spikeMs = 0.0f;
+	if (cfg.outlierRejection && gpuTimes[inApp].size() >= outlierMinSamples)
+		spikeMs = gpuTimes[inApp].percentile(50) * outlierSpikeFactor;
+
+	// Only the frames that drive decisions, the rest are skipped below
+	double tickGpu = 0.0;
+	uint32_t tickFrames = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const FrameSample &frame = frames[i];
+
+		// Get total GPU Frametime
+		float gpuTime = frame.totalRenderGpuMs;
+		// Calculate CPU Frametime, the compositor's share isn't the game's load unless asked for
+		// https://github.com/Louka3000/OpenVR-Dynamic-Resolution/issues/18#issuecomment-1833105172
+		float cpuTime = stageMs(frame, Stage::AppCpu); // Application & Late Start
+		if (!cfg.appCpuTimeOnly)
+			cpuTime += frame.compositorRenderCpuMs; // Compositor
+
+		// Adjust the CPU time off GPU reprojection.
+		lastRawCpuTime = cpuTime;
+		cpuTime *= std::min((double)frame.numFramePresents, floor(gpuTime / realTarget) + 1);
+
+		// Every frame shows up in the stages, only the ones of the application playing drive decisions
+		pipeline.push(frame);
+		SessionState state = session.tag(lastRawCpuTime, cfg.minCpuTimeThreshold);
+		stateFrames[size_t(state)]++;
+		if (state != SessionState::InApp)
+		{
+			gpuTimes[size_t(state)].push(gpuTime);
+			cpuTimes[size_t(state)].push(cpuTime);
+			continue;
+		}
+
+		// Hitches are made of the frames that get dropped and spike
+		reprojection.push(frame.reprojectionFlags);
+		report.addFrame(gpuTime, lastRawCpuTime, frame.numFramePresents, frame.numDroppedFrames);
+		hitch.add(frame.systemTimeInSeconds, gpuTime, frame.numFramePresents, frame.numDroppedFrames, expectedPresents);
+
+		// Dropped frames and isolated spikes say nothing about the load at this resolution
+		bool outlier = (frame.numDroppedFrames > 0 && hitch.measuring()) || (spikeMs > 0 && gpuTime > spikeMs);
+		outlierRun = outlier ? outlierRun + 1 : 0;
+		if (cfg.outlierRejection && outlier && outlierRun <= outlierMaxRun)
+		{
+			outliers++;
+			continue;
+		}
+
+		gpuTimes[inApp].push(gpuTime);
+		cpuTimes[inApp].push(cpuTime);
+		rawCpuTimes.push(lastRawCpuTime);
+		costModel.add(pixels, gpuTime);
+		tickGpuSum += gpuTime;
+		tickGpuCount++;
+		tickGpu += gpuTime;
+		tickFrames++;
+
+		// Nor does the hitch of the change
+		if (!hitch.measuring())
+			gpuTrend.add(frame.systemTimeInSeconds, gpuTime);
+	}
+
+	// Did the frametime rise like the last early decrease expected? Frametimes are scaled
+	// back to the resolution before the decrease, ignoring the hitch of the change itself.
+	if (predictions.pending)
+	{
+		if (tickFrames > 0 && !hitch.measuring() && input.currentRes > 0 &&
+			tickGpu / tickFrames * predictions.res / input.currentRes > predictions.thresholdMs)
+		{
+			predictions.confirmed++;
+			predictions.pending = false;
+		}
+		else if (input.timeMs >= predictions.untilMs)
+		{
+			predictions.missed++;
+			predictions.pending = false;
+		}
+	}
+
+	// Average CPU frametime, and GPU frametime (or its tail if the user wants to)
+	const FrametimeStats &gpuInApp = gpuTimes[inApp];
+	avgGpuTime = cfg.gpuTimePercentile > 0 ? gpuInApp.percentile(cfg.gpuTimePercentile) : gpuInApp.average();
+	avgCpuTime = cpuTimes[inApp].average();
+
+	// Double the target frametime if the user wants to, or if the CPU can't keep up with
+	// the HMD refresh rate (see RateModeSelector for when and how fast the mode switches)
+	nativeRes = sustainableRes(realTarget, input);
+	halfRes = sustainableRes(realTarget * 2, input);
+	RateModeInput mode;
+	mode.timeMs = input.timeMs;
+	mode.realTargetMs = realTarget;
+	mode.cpuMs = rawCpuTimes.average();
+	mode.cpuBound = cpuBound();
+	mode.nativeRes = nativeRes;
+	mode.halfRes = halfRes;
+	mode.minRes = cfg.minRes;
+	mode.alwaysReproject = cfg.alwaysReproject;
+	mode.preferReprojection = cfg.preferReprojection;
+	mode.ignoreCpuTime = cfg.ignoreCpuTime;
+	mode.hysteresis = cfg.modeHysteresis;
+	mode.minDwellMs = cfg.modeMinDwellMs;
+	if (rateMode.update(mode) == RateMode::Half)
+		target *= 2;
+
+	// Throttling makes the frametime creep up for minutes, which would otherwise look like the
+	// scene getting heavier and then lighter again each time the hardware cools down a bit
+	ThrottleInput thermal;
+	thermal.timeMs = input.timeMs;
+	if (cfg.thermalMonitorEnabled)
+		thermal.sample = input.thermal;
+	thermal.gpuBusy = avgGpuTime > target * cfg.resIncreaseThreshold;
+	thermal.gpuTempLimit = cfg.throttleGpuTemp;
+	thermal.cpuTempLimit = cfg.throttleCpuTemp;
+	thermal.clockRatio = cfg.throttleClockRatio;
+	thermal.releaseMs = cfg.throttleReleaseMs;
+	bool wasThrottling = throttleDetector.throttling();
+	if (throttleDetector.update(thermal) && !wasThrottling)
+		ceiling = std::clamp(input.currentRes * cfg.throttleResCeiling, cfg.minRes, cfg.maxRes);
+
+	// Resolution handling
+	if (input.timeMs - cfg.resChangeDelayMs > lastChange)
+	{
+		lastChange = input.timeMs;
+
+		// Frozen while the dashboard is open or another application is starting, keeping the history
+		SessionState state = session.state();
+		if (state != SessionState::Dashboard && state != SessionState::Transition)
+			decision = decide(input);
+		if (decision.changed)
+		{
+			hitch.begin(input.currentRes, decision.newRes, gpuTimes[inApp].percentile(50));
+			report.addChange(input.currentRes, decision.newRes);
+		}
+		// Once per increase held back, not on every decision that keeps holding it
+		if (decision.skipped && !holdingIncrease)
+			skipped++;
+		holdingIncrease = decision.skipped;
+		if (decision.action == Action::PredictedDecrease && decision.changed)
+		{
+			// A newer prediction replaces one that is still pending
+			predictions.fired++;
+			predictions.pending = true;
+			predictions.untilMs = input.timeMs + cfg.resChangeDelayMs;
+			predictions.res = input.currentRes;
+			predictions.thresholdMs = target * cfg.resDecreaseThreshold;
+		}
+
+		tickGpuSum = 0.0;
+		tickGpuCount = 0;
+	}
+
+	return decision;
+}
+
+void ResolutionController::setConfig(const ControllerConfig &config)
+{
+	cfg = config;
+	for (size_t i = 0; i < sessionStateCount; i++)
+	{
+		gpuTimes[i].resize(config.dataWindowSamples, config.dataAverageSamples);
+		cpuTimes[i].resize(config.dataWindowSamples, config.dataAverageSamples);
+	}
+	rawCpuTimes.resize(config.dataWindowSamples, config.dataAverageSamples);
+	pipeline.resize(config.dataWindowSamples, config.dataAverageSamples);
+	costModel.setMemory(config.dataAverageSamples);
+	reprojection.resize(config.dataAverageSamples);
+}
+
+void ResolutionController::beginTransition(long timeMs)
+{
+	session.beginTransition(timeMs + cfg.appTransitionMs);
+}
+
+void ResolutionController::reset(long timeMs)
+{
+	for (size_t i = 0; i < sessionStateCount; i++)
+	{
+		gpuTimes[i].clear();
+		cpuTimes[i].clear();
+	}
+	rawCpuTimes.clear();
+	pipeline.clear();
+	costModel.clear();
+	hitch.clear();
+	reprojection.clear();
+	gpuTrend.clear();
+	predictions.pending = false;
+	holdingIncrease = false;
+	outlierRun = 0;
+	tickGpuSum = 0.0;
+	tickGpuCount = 0;
+	started = true;
+	lastChange = timeMs;
+}
+
+bool ResolutionController::cpuBound() const
+{
+	return reprojection.cpuLimitedShare() >= cpuBoundShare && reprojection.gpuLimitedShare() < cpuBoundMaxGpuShare;
+}
+
+long ResolutionController::nextPollDelay(long timeMs) const
+{
+	long sinceChange = timeMs - lastChange;
+	long sleepTime = cfg.dataPullDelayMs;
+	if (cfg.dataPullDelayMs < sinceChange && cfg.resChangeDelayMs < sinceChange)
+	{
+		sleepTime = sinceChange - cfg.resChangeDelayMs;
+	}
+	else if (cfg.resChangeDelayMs < cfg.dataPullDelayMs)
+	{
+		sleepTime = cfg.resChangeDelayMs;
+	}
+	return sleepTime;
+}
+
+float ResolutionController::sustainableRes(float targetMs, const ControllerInput &input) const
+{
+	if (avgGpuTime <= 0 || input.currentRes <= 0)
+		return 0.0f;
+
+	// Same as the jump of the model mode: only the part of the frametime that scales with pixels follows the resolution
+	double fixedShare = 0.0;
+	if (costModel.ready())
+	{
+		double pixels = input.currentRes * pixelsAtFullRes(input);
+		fixedShare = std::clamp(costModel.fixedMs() / costModel.predictGpuMs(pixels), 0.0, maxFixedShare);
+	}
+	double scale = (targetMs * cfg.resIncreaseThreshold / avgGpuTime - fixedShare) / (1.0 - fixedShare);
+	// Out of reach at any resolution still counts as known
+	return std::clamp(float(input.currentRes * scale), 0.01f, cfg.maxRes);
+}
+
+Decision ResolutionController::decide(const ControllerInput &input) const
+{
+	Decision decision;
+	float lastRes = input.currentRes;
+	float newRes = lastRes;
+	float vramUsage = input.vramUsage;
+
+	// Adjust resolution
+	SessionState state = session.state();
+	if ((state == SessionState::InApp && avgCpuTime > cfg.minCpuTimeThreshold) || cfg.vramOnlyMode)
+	{
+		// Frametime
+		if (cfg.controllerMode == 1 && costModel.ready() && !cfg.vramOnlyMode)
+		{
+			// Outside of the thresholds, jump straight to the resolution predicted to land on the
+			// increase threshold. The fit only provides the share of the frametime that doesn't scale
+			// with pixels; frames since the last decision anchor it so a scene change doesn't need a refit.
+			double gpuTime = tickGpuCount > 0 && cfg.gpuTimePercentile <= 0 ? tickGpuSum / tickGpuCount : avgGpuTime;
+			if ((gpuTime < target * cfg.resIncreaseThreshold && vramUsage < cfg.vramTarget) || gpuTime > target * cfg.resDecreaseThreshold)
+			{
+				double pixels = lastRes * pixelsAtFullRes(input);
+				double fixedShare = std::clamp(costModel.fixedMs() / costModel.predictGpuMs(pixels), 0.0, maxFixedShare);
+				double scale = (target * cfg.resIncreaseThreshold / gpuTime - fixedShare) / (1.0 - fixedShare);
+				float predictedRes = float(lastRes * std::max(scale, 0.0));
+				// Changes smaller than the stepping minimums aren't worth the hitch
+				if (predictedRes > lastRes + cfg.resIncreaseMin && vramUsage < cfg.vramTarget)
+				{
+					newRes = predictedRes;
+					decision.action = Action::Increase;
+				}
+				else if (predictedRes < lastRes - cfg.resDecreaseMin)
+				{
+					newRes = predictedRes;
+					decision.action = Action::Decrease;
+				}
+			}
+		}
+		else if (avgGpuTime < target * cfg.resIncreaseThreshold && vramUsage < cfg.vramTarget && !cfg.vramOnlyMode)
+		{
+			// Increase resolution
+			newRes += ((((target * cfg.resIncreaseThreshold) - avgGpuTime) / target) *
+					   cfg.resIncreaseScale) +
+					  cfg.resIncreaseMin;
+			decision.action = Action::Increase;
+		}
+		else if (avgGpuTime > target * cfg.resDecreaseThreshold && !cfg.vramOnlyMode)
+		{
+			// Decrease resolution
+			newRes -= (((avgGpuTime - (target * cfg.resDecreaseThreshold)) / target) *
+					   cfg.resDecreaseScale) +
+					  cfg.resDecreaseMin;
+			decision.action = Action::Decrease;
+		}
+
+		// Decrease before the threshold is crossed if the trend says it will be before the next decision
+		if (decision.action == Action::None && cfg.predictiveDecrease && !cfg.vramOnlyMode && gpuTrend.rising(cfg.resChangeDelayMs))
+		{
+			float projectedGpuTime = gpuTrend.project(cfg.resChangeDelayMs);
+			if (projectedGpuTime > target * cfg.resDecreaseThreshold)
+			{
+				newRes -= (((projectedGpuTime - (target * cfg.resDecreaseThreshold)) / target) *
+						   cfg.resDecreaseScale) +
+						  cfg.resDecreaseMin;
+				decision.action = Action::PredictedDecrease;
+			}
+		}
+
+		// Cutting resolution doesn't help when the frames are late on the CPU
+		if ((decision.action == Action::Decrease || decision.action == Action::PredictedDecrease) && !cfg.ignoreCpuTime && cpuBound())
+		{
+			newRes = lastRes;
+			decision.action = Action::None;
+		}
+
+		// VRAM
+		if (vramUsage > cfg.vramLimit)
+		{
+			// Force the resolution to decrease when the vram limit is reached
+			newRes -= cfg.resDecreaseMin;
+			decision.action = Action::VramDecrease;
+		}
+		else if (cfg.vramOnlyMode && newRes < cfg.initialRes && vramUsage < cfg.vramTarget)
+		{
+			// When in VRAM-only mode, make sure the res goes back up when possible.
+			newRes = std::min(cfg.initialRes, newRes + cfg.resIncreaseMin);
+			decision.action = Action::VramRestore;
+		}
+
+		// Clamp the new resolution
+		newRes = std::clamp(newRes, cfg.minRes, cfg.maxRes);
+
+		// Only increase if it gains more than the hitch of the change costs.
+		// Decreases aren't held back, staying over budget costs more frames than the hitch.
+		if (decision.action == Action::Increase && cfg.hitchCostWeight > 0 && hitch.ready() &&
+			newRes - lastRes < cfg.hitchCostWeight * hitch.estimate().missedFrames)
+		{
+			newRes = lastRes;
+			decision.action = Action::None;
+			decision.skipped = true;
+		}
+	}
+	else if (cfg.resetOnThreshold && lastRes != cfg.initialRes && state == SessionState::Loading && !cfg.vramOnlyMode)
+	{
+		// Reset to initialRes because CPU time fell below the threshold
+		newRes = cfg.initialRes;
+		decision.action = Action::Reset;
+	}
+
+	// Stay under the ceiling while throttling, the frametime only comes back once the hardware cools down
+	if (throttleDetector.throttling() && newRes > ceiling)
+	{
+		newRes = ceiling;
+		if (newRes < lastRes)
+			decision.action = Action::ThrottleDecrease;
+		else if (newRes == lastRes)
+			decision.action = Action::None;
+	}
+
+	decision.newRes = newRes;
+	decision.changed = newRes != lastRes;
+	return decision;
+}
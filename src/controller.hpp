@@ -0,0 +1,279 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "hitch.hpp"
+#include "model.hpp"
+#include "pipeline.hpp"
+#include "ratemode.hpp"
+#include "report.hpp"
+#include "reprojection.hpp"
+#include "session.hpp"
+#include "thermal.hpp"
+#include "trend.hpp"
+#include "stats.hpp"
+
+// Tuning of the resolution controller (see SettingsDescription.txt)
+struct ControllerConfig
+{
+	float initialRes = 1.0f;
+	float minRes = 0.60f;
+	float maxRes = 5.0f;
+	long dataPullDelayMs = 250;
+	long resChangeDelayMs = 1400;
+	float minCpuTimeThreshold = 1.0f;
+	float resIncreaseMin = 0.03f;
+	float resDecreaseMin = 0.09f;
+	float resIncreaseScale = 0.60f;
+	float resDecreaseScale = 0.9f;
+	float resIncreaseThreshold = 0.75f;
+	float resDecreaseThreshold = 0.85f;
+	int dataAverageSamples = 256;
+	int dataWindowSamples = 1024;
+	float gpuTimePercentile = 0.0f;
+	int resetOnThreshold = 1;
+	int alwaysReproject = 0;
+	float vramTarget = 0.8f;
+	float vramLimit = 0.9f;
+	int vramMonitorEnabled = 1;
+	int vramOnlyMode = 0;
+	int preferReprojection = 0;
+	int ignoreCpuTime = 0;
+	// Only count the application's CPU time, not the compositor's, as CPU frametime
+	int appCpuTimeOnly = 1;
+	// Poll less often while frametimes are stable, the dashboard is open or no game is running
+	int adaptivePolling = 1;
+	long idlePollDelayMs = 2000;
+	// 0 = step towards the target, 1 = jump to the resolution predicted by the GPU cost model
+	int controllerMode = 0;
+	// Resolution (1 = 100%) one frame missed after a change is worth; increases gaining less
+	// than the measured hitch cost are skipped (0 = disabled)
+	float hitchCostWeight = 0.01f;
+	// Decrease early when the GPU frametime trend crosses resDecreaseThreshold within resChangeDelayMs
+	int predictiveDecrease = 1;
+	// Relative margin the CPU frametime (or the sustainable resolution) has to cross the
+	// native/half rate boundary by, and the shortest time spent in a mode before switching back
+	float modeHysteresis = 0.1f;
+	long modeMinDwellMs = 5000;
+	// Recognize thermal and power throttling from the sensors (see ThrottleDetector): temperature
+	// limits in degrees Celsius (0 = ignored), the share of its highest clock a busy GPU has to fall under,
+	// and how long every reason has to be gone for throttling to be over
+	int thermalMonitorEnabled = 1;
+	float throttleGpuTemp = 90.0f;
+	float throttleCpuTemp = 95.0f;
+	float throttleClockRatio = 0.8f;
+	long throttleReleaseMs = 10000;
+	// Highest resolution while throttling, relative to the one when it started
+	float throttleResCeiling = 0.9f;
+	// How long decisions stay frozen after another application starts rendering
+	long appTransitionMs = 3000;
+	// Leave dropped frames and isolated GPU frametime spikes out of the averages
+	int outlierRejection = 1;
+};
+
+// One compositor frame, mirroring vr::Compositor_FrameTiming without depending on OpenVR
+struct FrameSample
+{
+	uint32_t frameIndex = 0;
+	uint32_t numFramePresents = 1;
+	uint32_t numMisPresented = 0;
+	uint32_t numDroppedFrames = 0;
+	uint32_t reprojectionFlags = 0;
+	// Where the double would leave padding, traces write the whole struct
+	uint32_t reserved = 0;
+	double systemTimeInSeconds = 0.0;
+	float preSubmitGpuMs = 0.0f;
+	float postSubmitGpuMs = 0.0f;
+	float totalRenderGpuMs = 0.0f;
+	float compositorRenderGpuMs = 0.0f;
+	float compositorRenderCpuMs = 0.0f;
+	float compositorIdleCpuMs = 0.0f;
+	float clientFrameIntervalMs = 0.0f;
+	float presentCallCpuMs = 0.0f;
+	float waitForPresentCpuMs = 0.0f;
+	float submitFrameMs = 0.0f;
+	float waitGetPosesCalledMs = 0.0f;
+	float newPosesReadyMs = 0.0f;
+	float newFrameReadyMs = 0.0f;
+	float compositorUpdateStartMs = 0.0f;
+	float compositorUpdateEndMs = 0.0f;
+	float compositorRenderStartMs = 0.0f;
+	uint32_t numVSyncsReadyForUse = 0;
+	uint32_t numVSyncsToFirstView = 0;
+};
+
+// Everything the controller needs to know about the runtime for one tick
+struct ControllerInput
+{
+	long timeMs = 0;
+	// Supersample scale currently applied
+	float currentRes = 1.0f;
+	// HMD refresh rate
+	float displayHz = 90.0f;
+	// Fraction of VRAM in use (0-1)
+	float vramUsage = 0.0f;
+	bool dashboardVisible = false;
+	// Pixels rendered per eye at 100% resolution (0 if unknown)
+	float basePixels = 0.0f;
+	// Temperatures, clocks and power draw (0 where unavailable)
+	ThermalSample thermal;
+};
+
+enum class Action
+{
+	None,
+	Increase,
+	Decrease,
+	VramDecrease,
+	VramRestore,
+	Reset,
+	PredictedDecrease,
+	ThrottleDecrease,
+};
+
+const char *actionName(Action action);
+
+struct Decision
+{
+	Action action = Action::None;
+	float newRes = 1.0f;
+	// Whether newRes differs from the resolution currently applied
+	bool changed = false;
+	// An increase was held back because it would gain less than its hitch costs
+	bool skipped = false;
+};
+
+// Turns frame timings into resolution decisions. Knows nothing about OpenVR,
+// so it can be driven by the runtime as well as by recorded or synthetic traces.
+class ResolutionController
+{
+public:
+	explicit ResolutionController(const ControllerConfig &config);
+
+	// Feeds the frames presented since the previous tick, then decides on a new resolution
+	Decision update(const ControllerInput &input, const FrameSample *frames, uint32_t count);
+
+	const ControllerConfig &config() const { return cfg; }
+	// Switches to new parameters, keeping the frame history
+	void setConfig(const ControllerConfig &config);
+
+	float averageGpuTime() const { return avgGpuTime; }
+	float averageCpuTime() const { return avgCpuTime; }
+	// Latest CPU frametime before the reprojection adjustment
+	float rawCpuTime() const { return lastRawCpuTime; }
+	// Frametime the GPU is held to (doubled when reprojecting on purpose)
+	float targetFrametime() const { return target; }
+	// Frametime of the HMD refresh rate
+	float realTargetFrametime() const { return realTarget; }
+	// Whether the target is set for native or half rate, and since when
+	const RateModeSelector &rateModes() const { return rateMode; }
+	// Resolution the GPU could sustain at the increase threshold in each mode (0 if unknown)
+	float nativeResEstimate() const { return nativeRes; }
+	float halfResEstimate() const { return halfRes; }
+	long lastChangeTime() const { return lastChange; }
+
+	// Another application started rendering: its frames are kept apart and decisions
+	// wait for appTransitionMs, then for a full resChangeDelayMs of its frames
+	void beginTransition(long timeMs);
+	// Forgets the frame history, e.g. when starting from the profile of another application.
+	// The next decision waits for a full resChangeDelayMs of new frames.
+	void reset(long timeMs);
+
+	// How long to wait before the next tick so that it lands right when the next change is allowed
+	long nextPollDelay(long timeMs) const;
+
+	// Frametimes of the frames tagged with a session state, only in-app ones drive decisions
+	const FrametimeStats &gpuStats(SessionState state = SessionState::InApp) const { return gpuTimes[size_t(state)]; }
+	const FrametimeStats &cpuStats(SessionState state = SessionState::InApp) const { return cpuTimes[size_t(state)]; }
+	// State of the session as of the latest frame, and how many frames each state got so far
+	SessionState sessionState() const { return session.state(); }
+	uint64_t sessionFrames(SessionState state) const { return stateFrames[size_t(state)]; }
+	// In-app frames left out of the averages for being dropped or spiking
+	uint64_t outlierFrames() const { return outliers; }
+	// Every stage of the frames, as the compositor reports them
+	const PipelineStats &pipelineStats() const { return pipeline; }
+	// GPU frametime against rendered pixels
+	const GpuCostModel &gpuModel() const { return costModel; }
+	// Why the recent frames were reprojected
+	const ReprojectionStats &reprojectionStats() const { return reprojection; }
+	// Most of the recent frames were late on the CPU rather than the GPU
+	bool cpuBound() const;
+	// Cost of the resolution changes so far
+	const HitchTracker &hitches() const { return hitch; }
+	// Starts from another hitch estimate, e.g. the one of the application that just started
+	void restoreHitchEstimate(const HitchEstimate &estimate) { hitch.restore(estimate); }
+	// Increases held back for their hitch cost, each counted once however long it's held
+	uint64_t skippedChanges() const { return skipped; }
+
+	// Trend of the GPU frametime since the resolution last changed
+	const TrendPredictor &gpuTrendStats() const { return gpuTrend; }
+	// Early decreases made, and how many of them were followed by the frametime
+	// actually crossing resDecreaseThreshold within resChangeDelayMs (or not)
+	uint64_t predictionsFired() const { return predictions.fired; }
+	uint64_t predictionsConfirmed() const { return predictions.confirmed; }
+	uint64_t predictionsMissed() const { return predictions.missed; }
+
+	// Whether the hardware is throttling, and why
+	const ThrottleDetector &throttle() const { return throttleDetector; }
+	// Highest resolution allowed while throttling (0 when not throttling)
+	float throttleCeiling() const { return throttleDetector.throttling() ? ceiling : 0.0f; }
+
+	// Histograms of the whole session, kept through resets
+	const SessionReport &sessionReport() const { return report; }
+
+private:
+	Decision decide(const ControllerInput &input) const;
+	// Resolution at which the GPU frametime should land on targetMs * resIncreaseThreshold
+	float sustainableRes(float targetMs, const ControllerInput &input) const;
+
+	ControllerConfig cfg;
+	SessionTracker session;
+	// Indexed by SessionState
+	std::vector<FrametimeStats> gpuTimes;
+	std::vector<FrametimeStats> cpuTimes;
+	uint64_t stateFrames[sessionStateCount] = {};
+	uint64_t outliers = 0;
+	uint32_t outlierRun = 0;
+	// CPU frametimes before the reprojection adjustment, which would keep half rate going by itself
+	FrametimeStats rawCpuTimes;
+	PipelineStats pipeline;
+	GpuCostModel costModel;
+	HitchTracker hitch;
+	ReprojectionStats reprojection;
+	TrendPredictor gpuTrend;
+	float trendRes = 0.0f;
+	RateModeSelector rateMode;
+	ThrottleDetector throttleDetector;
+	float ceiling = 0.0f;
+	SessionReport report;
+
+	// Checks each early decrease against what happened next
+	struct Predictions
+	{
+		uint64_t fired = 0;
+		uint64_t confirmed = 0;
+		uint64_t missed = 0;
+		bool pending = false;
+		long untilMs = 0;
+		// Resolution before the decrease, frametimes are scaled back to it
+		float res = 0.0f;
+		float thresholdMs = 0.0f;
+	} predictions;
+	uint64_t skipped = 0;
+	// The last decision held an increase back
+	bool holdingIncrease = false;
+	// GPU frametime of the frames since the last decision, all rendered at the current resolution
+	double tickGpuSum = 0.0;
+	uint32_t tickGpuCount = 0;
+
+	bool started = false;
+	long lastChange = 0;
+	float avgGpuTime = 0.0f;
+	float avgCpuTime = 0.0f;
+	float lastRawCpuTime = 0.0f;
+	float target = 0.0f;
+	float realTarget = 0.0f;
+	float nativeRes = 0.0f;
+	float halfRes = 0.0f;
+};
@@ -0,0 +1,107 @@
+#include "hitch.hpp"
+
+#include <algorithm>
+
+// Weight of each frame in the usual miss rate
+static constexpr double missRateSmoothing = 1.0 / 256;
+// Weight of each change in the running estimate
+static constexpr float estimateSmoothing = 0.3f;
+
+void HitchTracker::add(double timeS, float gpuMs, uint32_t presents, uint32_t dropped, uint32_t expectedPresents)
+{
+	// A frame shown more often than planned, or not shown at all, missed its vsync
+	uint32_t late = presents > expectedPresents ? presents - expectedPresents : 0;
+	double frameMissed = std::max(late, dropped);
+
+	if (!active)
+	{
+		missRate += (frameMissed - missRate) * missRateSmoothing;
+		lastFrameS = timeS;
+		return;
+	}
+
+	// No frame was seen before the change
+	if (startS <= 0)
+		startS = timeS;
+
+	frames++;
+	missed += frameMissed;
+	if (timeS - startS >= settledS)
+	{
+		settledMissed += frameMissed;
+		settledFrames++;
+	}
+	current.spikeMs = std::max(current.spikeMs, gpuMs - baselineGpuMs);
+	if (frameMissed > 0)
+	{
+		cleanRun = 0;
+		lastMissS = timeS;
+		framesToLastMiss = frames;
+	}
+	else
+	{
+		cleanRun++;
+	}
+	lastFrameS = timeS;
+
+	if (cleanRun >= cleanRunFrames || timeS - startS >= maxWindowS)
+		finish();
+}
+
+void HitchTracker::begin(float fromRes, float toRes, float baselineGpuMs)
+{
+	// A change during a measurement makes it impossible to tell the two apart, so the first one is dropped
+	current = HitchEvent();
+	current.fromRes = fromRes;
+	current.toRes = toRes;
+	this->baselineGpuMs = baselineGpuMs;
+	startS = lastFrameS;
+	missed = 0.0;
+	frames = 0;
+	cleanRun = 0;
+	lastMissS = 0.0;
+	framesToLastMiss = 0;
+	settledMissed = 0.0;
+	settledFrames = 0;
+	active = true;
+}
+
+void HitchTracker::finish()
+{
+	active = false;
+
+	// Misses up to the last one, minus what would have been missed anyway
+	double usualRate = missRate;
+	if (settledFrames > 0)
+		usualRate = std::max(usualRate, settledMissed / settledFrames);
+	current.missedFrames = float(std::max(0.0, missed - usualRate * framesToLastMiss));
+	current.recoveryMs = framesToLastMiss > 0 ? float((lastMissS - startS) * 1000.0) : 0.0f;
+	current.spikeMs = std::max(0.0f, current.spikeMs);
+	lastEvent = current;
+
+	if (est.samples == 0)
+	{
+		est.missedFrames = current.missedFrames;
+		est.spikeMs = current.spikeMs;
+		est.recoveryMs = current.recoveryMs;
+	}
+	else
+	{
+		est.missedFrames += (current.missedFrames - est.missedFrames) * estimateSmoothing;
+		est.spikeMs += (current.spikeMs - est.spikeMs) * estimateSmoothing;
+		est.recoveryMs += (current.recoveryMs - est.recoveryMs) * estimateSmoothing;
+	}
+	est.samples++;
+}
+
+void HitchTracker::clear()
+{
+	est = HitchEstimate();
+	lastEvent = HitchEvent();
+	active = false;
+}
+
+void HitchTracker::restore(const HitchEstimate &estimate)
+{
+	est = estimate;
+}
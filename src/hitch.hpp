@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+
+// What one resolution change cost, measured on the frames that followed it
+struct HitchEvent
+{
+	float fromRes = 0.0f;
+	float toRes = 0.0f;
+	// Slowest GPU frametime after the change, above the median before it
+	float spikeMs = 0.0f;
+	// Frames missed after the change, beyond the usual miss rate
+	float missedFrames = 0.0f;
+	// Time from the change until frames ran clean again
+	float recoveryMs = 0.0f;
+};
+
+// Running average of the cost of the recent changes
+struct HitchEstimate
+{
+	float missedFrames = 0.0f;
+	float spikeMs = 0.0f;
+	float recoveryMs = 0.0f;
+	uint32_t samples = 0;
+};
+
+// Measures the frame spikes that follow each resolution change, when the
+// compositor and the game reallocate their render targets. A measurement
+// ends once enough clean frames came in a row, or after maxWindowS. Frames
+// that keep missing because the new resolution is simply too heavy aren't
+// the change's fault: the miss rate of the end of the window is discounted.
+class HitchTracker
+{
+public:
+	// Frames in a row that have to be on time for a change to count as recovered
+	static constexpr uint32_t cleanRunFrames = 20;
+	// Longest a measurement lasts
+	static constexpr double maxWindowS = 3.0;
+	// Frames this long after the change show the new normal
+	static constexpr double settledS = 2.0;
+	// Changes measured before the estimate is trusted
+	static constexpr uint32_t minSamples = 3;
+
+	// Feeds one frame. expectedPresents is how many times an on-time frame
+	// is shown (2 when reprojecting on purpose).
+	void add(double timeS, float gpuMs, uint32_t presents, uint32_t dropped, uint32_t expectedPresents);
+
+	// A change from fromRes to toRes is applied after the last frame added
+	void begin(float fromRes, float toRes, float baselineGpuMs);
+
+	// Forgets the estimate and any measurement in progress
+	void clear();
+	// Continues from an earlier estimate, e.g. the one saved in an application's profile
+	void restore(const HitchEstimate &estimate);
+
+	bool measuring() const { return active; }
+	bool ready() const { return est.samples >= minSamples; }
+	const HitchEstimate &estimate() const { return est; }
+	// Latest completed measurement
+	const HitchEvent &last() const { return lastEvent; }
+
+private:
+	void finish();
+
+	HitchEstimate est;
+	HitchEvent lastEvent;
+	HitchEvent current;
+	// Share of frames missed outside of changes
+	double missRate = 0.0;
+	double lastFrameS = 0.0;
+
+	bool active = false;
+	float baselineGpuMs = 0.0f;
+	double startS = 0.0;
+	double missed = 0.0;
+	uint32_t frames = 0;
+	uint32_t cleanRun = 0;
+	// Last frame of the measurement that missed its vsync
+	double lastMissS = 0.0;
+	uint32_t framesToLastMiss = 0;
+	// Frames after settledS
+	double settledMissed = 0.0;
+	uint32_t settledFrames = 0;
+};
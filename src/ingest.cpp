@@ -0,0 +1,52 @@
+#include "ingest.hpp"
+
+#include <algorithm>
+
+// Extra frames requested in case the compositor presented more between our two calls
+static constexpr uint32_t fetchSlack = 4;
+
+uint32_t FrameIngest::poll()
+{
+	newFrames = 0;
+
+	// Find out how far the compositor got since the last poll
+	FrameSample current;
+	if (!runtime.getFrameTiming(current))
+		return 0;
+
+	if (!primed)
+	{
+		// Nothing to compare against yet, start from the current frame
+		primed = true;
+		lastFrameIndex = current.frameIndex;
+		last = current;
+		samples[0] = current;
+		newFrames = 1;
+		return newFrames;
+	}
+
+	uint32_t pending = current.frameIndex - lastFrameIndex;
+	if (pending == 0)
+		return 0;
+
+	uint32_t fetched = runtime.getFrameTimings(samples.data(), std::min(pending + fetchSlack, capacity));
+
+	// Frames come oldest first; drop the ones we've already seen
+	uint32_t first = 0;
+	while (first < fetched && int32_t(samples[first].frameIndex - lastFrameIndex) <= 0)
+		first++;
+	if (first == fetched)
+		return 0;
+
+	// Anything between the last seen frame and the oldest one we got was lost
+	missed += samples[first].frameIndex - lastFrameIndex - 1;
+
+	newFrames = fetched - first;
+	if (first > 0)
+		std::copy(samples.begin() + first, samples.begin() + fetched, samples.begin());
+
+	last = samples[newFrames - 1];
+	lastFrameIndex = last.frameIndex;
+
+	return newFrames;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "controller.hpp"
+#include "runtime.hpp"
+
+// Pulls every compositor frame presented since the previous poll into a fixed buffer
+class FrameIngest
+{
+public:
+	// Enough for ~880ms of frames at 144Hz between two polls
+	static constexpr uint32_t capacity = 128;
+
+	explicit FrameIngest(Runtime &runtime) : runtime(runtime) {}
+
+	// Fetches the frames newer than the last one seen, oldest first.
+	// Returns how many new frames are available through frames().
+	uint32_t poll();
+
+	const FrameSample *frames() const { return samples.data(); }
+	uint32_t count() const { return newFrames; }
+
+	// Most recent frame seen, even if the last poll returned nothing new
+	const FrameSample &latest() const { return last; }
+
+	// Frames that were presented but fell out of the buffer between two polls
+	uint64_t missedFrames() const { return missed; }
+
+private:
+	Runtime &runtime;
+	std::array<FrameSample, capacity> samples{};
+	FrameSample last{};
+	uint32_t newFrames = 0;
+	uint32_t lastFrameIndex = 0;
+	bool primed = false;
+	uint64_t missed = 0;
+};
@@ -0,0 +1,72 @@
+#include "latency.hpp"
+
+#include <algorithm>
+
+void LatencyStats::record(std::chrono::nanoseconds duration)
+{
+	uint64_t ns = uint64_t(std::max<int64_t>(duration.count(), 0));
+	uint64_t us = ns / 1000;
+
+	size_t bucket = 0;
+	while (bucket + 1 < bucketCount && (uint64_t(1) << bucket) <= us)
+		bucket++;
+
+	calls.fetch_add(1, std::memory_order_relaxed);
+	totalNs.fetch_add(ns, std::memory_order_relaxed);
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t previous = maxNs.load(std::memory_order_relaxed);
+	while (ns > previous && !maxNs.compare_exchange_weak(previous, ns, std::memory_order_relaxed))
+	{
+	}
+}
+
+double LatencyStats::meanUs() const
+{
+	uint64_t n = count();
+	return n > 0 ? totalNs.load(std::memory_order_relaxed) / 1000.0 / n : 0.0;
+}
+
+double LatencyStats::percentileUs(double p) const
+{
+	uint64_t n = count();
+	if (n == 0)
+		return 0.0;
+
+	uint64_t rank = uint64_t(std::clamp(p, 0.0, 100.0) / 100.0 * double(n - 1)) + 1;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < bucketCount; i++)
+	{
+		seen += buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+			return double(uint64_t(1) << i);
+	}
+	return double(uint64_t(1) << (bucketCount - 1));
+}
+
+const char *ipcCallName(IpcCall call)
+{
+	switch (call)
+	{
+	case IpcCall::FrameTimings:
+		return "frame-timings";
+	case IpcCall::PollEvents:
+		return "poll-events";
+	case IpcCall::GetSupersampleScale:
+		return "get-supersample-scale";
+	case IpcCall::SetSupersampleScale:
+		return "set-supersample-scale";
+	case IpcCall::DisplayFrequency:
+		return "display-frequency";
+	case IpcCall::DashboardVisible:
+		return "dashboard-visible";
+	case IpcCall::SceneProcessId:
+		return "scene-process-id";
+	case IpcCall::ApplicationKey:
+		return "application-key";
+	case IpcCall::RenderTargetSize:
+		return "render-target-size";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Latency histogram of one kind of call, recordable from any thread.
+// Buckets are powers of two microseconds, so percentiles are within 2x.
+class LatencyStats
+{
+public:
+	static constexpr size_t bucketCount = 24; // Up to ~8 s
+
+	void record(std::chrono::nanoseconds duration);
+
+	uint64_t count() const { return calls.load(std::memory_order_relaxed); }
+	double meanUs() const;
+	double maxUs() const { return maxNs.load(std::memory_order_relaxed) / 1000.0; }
+	// Upper bound of the bucket holding the p-th percentile (0-100)
+	double percentileUs(double p) const;
+
+private:
+	std::atomic<uint64_t> calls{0};
+	std::atomic<uint64_t> totalNs{0};
+	std::atomic<uint64_t> maxNs{0};
+	std::array<std::atomic<uint64_t>, bucketCount> buckets{};
+};
+
+// Round-trips to vrserver the program makes
+enum class IpcCall
+{
+	FrameTimings,
+	PollEvents,
+	GetSupersampleScale,
+	SetSupersampleScale,
+	DisplayFrequency,
+	DashboardVisible,
+	SceneProcessId,
+	ApplicationKey,
+	RenderTargetSize,
+};
+
+static constexpr size_t ipcCallCount = size_t(IpcCall::RenderTargetSize) + 1;
+
+const char *ipcCallName(IpcCall call);
+
+using IpcStats = std::array<LatencyStats, ipcCallCount>;
+
+// Runs call and records how long it took
+template <typename F>
+auto timeCall(IpcStats &stats, IpcCall call, F &&f)
+{
+	struct Record
+	{
+		LatencyStats &stats;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		~Record() { stats.record(std::chrono::steady_clock::now() - start); }
+	} record{stats[size_t(call)]};
+	return f();
+}
@@ -1,10 +1,13 @@
 #include <openvr.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <csignal>
+#include <future>
 #include <thread>
+#include <iostream>
 #include <fmt/core.h>
 #include <args.hxx>
-#include <curses.h>
 #include <stdlib.h>
 #ifdef _WIN32
 #include <Windows.h>
@@ -12,76 +15,34 @@
 #include <dlfcn.h>
 #endif
 
-#include "SimpleIni.h"
 #include "setup.hpp"
+#include "settings.hpp"
+#include "settingswatch.hpp"
+#include "mainloop.hpp"
+#include "closedloop.hpp"
+#include "simruntime.hpp"
+#include "vrruntime.hpp"
+#include "trace.hpp"
+#include "thermal.hpp"
+#include "vram.hpp"
+#include "profiles.hpp"
+#include "ui.hpp"
+#include "metrics.hpp"
+#include "report.hpp"
 
 using namespace std::chrono_literals;
 using namespace vr;
 
 static constexpr const char *version = "v.0.4.0";
 
-int autoStart = 1;
-int minimizeOnStart = 0;
-float initialRes = 1.0f;
-
-float minRes = 0.60;
-float maxRes = 5.0f;
-long dataPullDelayMs = 250;
-long resChangeDelayMs = 1400;
-float minCpuTimeThreshold = 1.0f;
-float resIncreaseMin = 0.03f;
-float resDecreaseMin = 0.09f;
-float resIncreaseScale = 0.60f;
-float resDecreaseScale = 0.9;
-float resIncreaseThreshold = 0.75;
-float resDecreaseThreshold = 0.85f;
-int dataAverageSamples = 16;
-int resetOnThreshold = 1;
-int alwaysReproject = 0;
-float vramTarget = 0.8;
-float vramLimit = 0.9;
-int vramMonitorEnabled = 1;
-int vramOnlyMode = 0;
-int preferReprojection = 0;
-int ignoreCpuTime = 0;
-
-
-bool loadSettings()
-{
-	// Get ini file
-	CSimpleIniA ini;
-	SI_Error rc = ini.LoadFile("settings.ini");
-	if (rc < 0)
-		return false;
-
-	// Get setting values
-	autoStart = std::stoi(ini.GetValue("Initialization", "autoStart", std::to_string(autoStart).c_str()));
-	minimizeOnStart = std::stoi(ini.GetValue("Initialization", "minimizeOnStart", std::to_string(minimizeOnStart).c_str()));
-	initialRes = std::stof(ini.GetValue("Initialization", "initialRes", std::to_string(initialRes * 100.0f).c_str())) / 100.0f;
-
-	minRes = std::stof(ini.GetValue("Resolution change", "minRes", std::to_string(minRes * 100.0f).c_str())) / 100.0f;
-	maxRes = std::stof(ini.GetValue("Resolution change", "maxRes", std::to_string(maxRes * 100.0f).c_str())) / 100.0f;
-	dataPullDelayMs = std::stol(ini.GetValue("Resolution change", "dataPullDelayMs", std::to_string(dataPullDelayMs).c_str()));
-	resChangeDelayMs = std::stol(ini.GetValue("Resolution change", "resChangeDelayMs", std::to_string(resChangeDelayMs).c_str()));
-	minCpuTimeThreshold = std::stof(ini.GetValue("Resolution change", "minCpuTimeThreshold", std::to_string(minCpuTimeThreshold).c_str()));
-	resIncreaseMin = std::stof(ini.GetValue("Resolution change", "resIncreaseMin", std::to_string(resIncreaseMin * 100.0f).c_str())) / 100.0f;
-	resDecreaseMin = std::stof(ini.GetValue("Resolution change", "resDecreaseMin", std::to_string(resDecreaseMin * 100.0f).c_str())) / 100.0f;
-	resIncreaseScale = std::stof(ini.GetValue("Resolution change", "resIncreaseScale", std::to_string(resIncreaseScale * 100.0f).c_str())) / 100.0f;
-	resDecreaseScale = std::stof(ini.GetValue("Resolution change", "resDecreaseScale", std::to_string(resDecreaseScale * 100.0f).c_str())) / 100.0f;
-	resIncreaseThreshold = std::stof(ini.GetValue("Resolution change", "resIncreaseThreshold", std::to_string(resIncreaseThreshold * 100.0f).c_str())) / 100.0f;
-	resDecreaseThreshold = std::stof(ini.GetValue("Resolution change", "resDecreaseThreshold", std::to_string(resDecreaseThreshold * 100.0f).c_str())) / 100.0f;
-	dataAverageSamples = std::stoi(ini.GetValue("Resolution change", "dataAverageSamples", std::to_string(dataAverageSamples).c_str()));
-	resetOnThreshold = std::stoi(ini.GetValue("Resolution change", "resetOnThreshold", std::to_string(resetOnThreshold).c_str()));
-	alwaysReproject = std::stoi(ini.GetValue("Resolution change", "alwaysReproject", std::to_string(alwaysReproject).c_str()));
-	vramLimit = std::stoi(ini.GetValue("Resolution change", "vramLimit", std::to_string(vramLimit * 100.0f).c_str())) / 100.0f;
-	vramTarget = std::stoi(ini.GetValue("Resolution change", "vramTarget", std::to_string(vramTarget * 100.0f).c_str())) / 100.0f;
-	vramMonitorEnabled = std::stoi(ini.GetValue("Resolution change", "vramMonitorEnabled", std::to_string(vramMonitorEnabled).c_str()));
-	vramOnlyMode = std::stoi(ini.GetValue("Resolution change", "vramOnlyMode", std::to_string(vramOnlyMode).c_str()));
-	preferReprojection = std::stoi(ini.GetValue("Resolution change", "preferReprojection", std::to_string(preferReprojection).c_str()));
-	ignoreCpuTime = std::stoi(ini.GetValue("Resolution change", "ignoreCpuTime", std::to_string(ignoreCpuTime).c_str()));
-
-	return true;
-}
+static constexpr const char *settingsPath = "settings.ini";
+
+// Per-application profiles, next to settings.ini
+static constexpr const char *profilesPath = "profiles.ini";
+// How long a resolution has to be held before it's saved to the application's profile
+static constexpr long profileSettleMs = 10000;
+// Most redraws per second of the window
+static constexpr int uiMaxRate = 10;
 
 long getCurrentTimeMillis()
 {
@@ -90,292 +51,283 @@ long getCurrentTimeMillis()
 	return millis.count();
 }
 
-int main(int argc, char *argv[])
+// Set from a signal or console handler to leave the loop
+static std::atomic<bool> stopRequested{false};
+
+#if defined(_WIN32)
+// Set once everything is shut down, closing the window waits for it
+static std::atomic<bool> stopped{false};
+
+static BOOL WINAPI consoleHandler(DWORD)
 {
+	stopRequested = true;
+	// The process ends as soon as this returns, give the loop a few seconds to finish
+	for (int i = 0; i < 40 && !stopped; i++)
+		Sleep(100);
+	return TRUE;
+}
+#else
+static void requestStop(int)
+{
+	stopRequested = true;
+}
+#endif
 
-	int rows, cols;		 // max rows and cols
-	initscr();			 // Initialize screen
-	cbreak();			 // Disable line-buffering (for input)
-	noecho();			 // Don't show what the user types
-	resize_term(20, 64); // Sets the initial (y, x) resolution
+// Sleeps for ms, waking up early when asked to stop
+static void sleepUnlessStopped(long ms)
+{
+	auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+	while (!stopRequested)
+	{
+		auto left = until - std::chrono::steady_clock::now();
+		if (left <= 0ms)
+			break;
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(left, 100ms));
+	}
+}
 
-	// Check for errors
-	EVRInitError init_error = VRInitError_None;
-	std::unique_ptr<IVRSystem, decltype(&shutdown_vr)> system(
-		VR_Init(&init_error, VRApplication_Overlay), &shutdown_vr);
-	if (init_error != VRInitError_None)
+// Ends the program before the loop started. Errors are shown in the window until a key is
+// pressed, the console window would close with the program before they could be read.
+static int exitEarly(const std::string &error)
+{
+	if (!error.empty() && !uiHeadless())
 	{
-		system = nullptr;
-		printw("%s", fmt::format("Unable to init VR runtime: {}\n", VR_GetVRInitErrorAsEnglishDescription(init_error)).c_str());
-		refresh();
-		std::this_thread::sleep_for(4000ms);
-		return EXIT_FAILURE;
+		uiPrint(fmt::format("{}\n\nPress any key to exit\n", error).c_str());
+		uiWaitForKey(stopRequested);
 	}
-	if (!VRCompositor())
+	uiEnd();
+	if (!error.empty())
+		std::cerr << error << std::endl;
+#if defined(_WIN32)
+	stopped = true;
+#endif
+	return error.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+	auto launchTime = std::chrono::steady_clock::now();
+
+	args::ArgumentParser parser("Dynamically adjusts the HMD's resolution to the GPU frametime, CPU frametime and VRAM.");
+	args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
+	args::Flag headless(parser, "headless", "Run without a window (implied by minimizeOnStart=2)", {"headless"});
+	args::ValueFlag<std::string> simulate(parser, "scenario", "Run against a simulated compositor instead of SteamVR (steady, bursty, scene-change, ramp, manual-step, cpu-bound)", {"simulate"});
+	try
 	{
-		printw("Failed to initialize VR compositor.");
-		refresh();
-		std::this_thread::sleep_for(4000ms);
+		parser.ParseCLI(argc, argv);
+	}
+	catch (const args::Help &)
+	{
+		std::cout << parser;
+		return EXIT_SUCCESS;
+	}
+	catch (const args::Error &e)
+	{
+		std::cerr << e.what() << std::endl
+				  << parser;
 		return EXIT_FAILURE;
 	}
 
-	// Load settings from ini file
-	bool settingsLoaded = loadSettings();
+	// Load settings from ini file, falling back to the defaults if they don't make sense
+	Settings settings;
+	std::string settingsError;
+	bool settingsLoaded = loadSettings(settingsPath, settings, &settingsError) && validateSettings(settings, settingsError);
+	if (!settingsLoaded)
+		settings = Settings();
+	std::string settingsStatus = settingsLoaded ? "settings.ini successfully loaded" : "Error loading settings.ini: " + settingsError;
+
+	// No window at all when it would be hidden anyway
+	uiInit(headless || settings.minimizeOnStart == 2);
+
+	// Ctrl+C, closing the window and being killed all end the session cleanly,
+	// including while waiting for SteamVR
+#if defined(_WIN32)
+	SetConsoleCtrlHandler(consoleHandler, TRUE);
+#else
+	std::signal(SIGINT, requestStop);
+	std::signal(SIGTERM, requestStop);
+	std::signal(SIGHUP, requestStop);
+#endif
+
+	// Connect to SteamVR, waiting for it to start if the user wants to
+	EVRInitError init_error = VRInitError_None;
+	int initAttempts = 0;
+	std::unique_ptr<IVRSystem, decltype(&shutdown_vr)> system(
+		simulate ? nullptr : init_vr(settings.waitForSteamVR, stopRequested, init_error, initAttempts), &shutdown_vr);
+	if (!simulate && !system)
+	{
+		// Asked to stop before SteamVR came up
+		if (stopRequested)
+			return exitEarly("");
+		return exitEarly(fmt::format("Unable to init VR runtime: {}", VR_GetVRInitErrorAsEnglishDescription(init_error)));
+	}
+	auto runtimeTime = std::chrono::steady_clock::now();
 
 #if defined(_WIN32)
 	// Minimize the window if user wants to
-	if (minimizeOnStart == 1)
+	if (settings.minimizeOnStart == 1)
 		ShowWindow(GetConsoleWindow(), SW_MINIMIZE);
-	else if (minimizeOnStart == 2)
+	else if (settings.minimizeOnStart == 2)
 		ShowWindow(GetConsoleWindow(), SW_HIDE);
 #endif
 
-	// Set auto-start
-	int autoStartResult = handle_setup(autoStart);
-
-	if (autoStartResult == 1)
+	// Pick the runtime to talk to
+	std::unique_ptr<Runtime> runtime;
+	SimRuntime *sim = nullptr;
+	if (simulate)
 	{
-		refresh();
-		std::this_thread::sleep_for(1000ms);
-		printw("Done!");
-		refresh();
-		std::this_thread::sleep_for(600ms);
+		SimConfig simConfig;
+		if (!simScenario(args::get(simulate), 90.0f, simConfig))
+		{
+			return exitEarly("Unknown scenario " + args::get(simulate));
+		}
+		sim = new SimRuntime(simConfig);
+		runtime.reset(sim);
 	}
-	else if (autoStartResult == 2)
+	else
 	{
-		refresh();
-		std::this_thread::sleep_for(4000ms);
+		runtime = std::make_unique<OpenVrRuntime>();
 	}
-	clear();
-	refresh();
 
 	// Set default resolution
-	vr::VRSettings()->SetFloat(vr::k_pch_SteamVR_Section,
-							   vr::k_pch_SteamVR_SupersampleScale_Float, initialRes);
+	runtime->setSupersampleScale(settings.controller.initialRes);
 
+	// Set auto-start in the background, the outcome shows up in the window
+	std::string autoStartStatus;
+	std::future<int> autoStart;
+	if (!simulate)
+		autoStart = std::async(std::launch::async, handle_setup, bool(settings.autoStart), std::ref(autoStartStatus));
+	uiClear();
 
 	// Initialize loop variables
-	long lastChangeTime = getCurrentTimeMillis();
-	std::list<float> gpuTimes;
-	std::list<float> cpuTimes;
+	TraceRecorder recorder;
+	if (!settings.traceFile.empty())
+		recorder.open(settings.traceFile);
+	MetricsPublisher metrics;
+	if (!settings.metricsSharedMemory.empty())
+		metrics.openSharedMemory(settings.metricsSharedMemory);
+	if (!settings.metricsSocket.empty())
+		metrics.openSocket(settings.metricsSocket);
+	// The host's VRAM has nothing to do with a simulated game
+	std::unique_ptr<VramProvider> vram;
+	if (sim)
+		vram = std::make_unique<NullVramProvider>();
+	else
+		vram = createVramProvider(settings.vramSysfsRoot);
+	// Same for its sensors
+	std::unique_ptr<ThermalSampler> thermal;
+	if (!sim)
+		thermal = std::make_unique<ThermalSampler>(settings.thermalSysfsRoot);
+	ProfileStore profiles;
+	if (settings.appProfiles)
+		profiles.load(profilesPath);
+
+	// Pick up edits of settings.ini while running
+	SettingsWatcher settingsWatcher(settingsPath, settings);
+	settingsWatcher.start();
+
+	// The window is drawn on its own thread from what the loop publishes
+	Seqlock<UiSnapshot> uiSnapshots;
+	UiThread uiThread(uiSnapshots, version, uiMaxRate);
+	uiThread.start();
+
+	long startTime = getCurrentTimeMillis();
+
+	// From launch until the loop starts, and how much of it was spent waiting for SteamVR
+	using msf = std::chrono::duration<float, std::milli>;
+	StartupInfo startup;
+	startup.simulated = sim != nullptr;
+	startup.startupMs = msf(std::chrono::steady_clock::now() - launchTime).count();
+	startup.steamVrWaitMs = simulate ? 0.0f : msf(runtimeTime - launchTime).count();
+	startup.initAttempts = initAttempts;
+	if (uiHeadless())
+	{
+		if (simulate)
+			fmt::print("Started in {:.0f} ms\n", startup.startupMs);
+		else
+			fmt::print("Started in {:.0f} ms (SteamVR after {:.0f} ms, {} tries)\n", startup.startupMs, startup.steamVrWaitMs, initAttempts);
+		std::fflush(stdout);
+	}
 
-	// event loop
-	while (true)
+	LoopServices services;
+	services.runtime = runtime.get();
+	services.settings = &settings;
+	services.settingsWatcher = &settingsWatcher;
+	services.vram = vram.get();
+	services.thermal = thermal.get();
+	services.profiles = &profiles;
+	services.profilesPath = profilesPath;
+	services.recorder = &recorder;
+	services.metrics = &metrics;
+	services.uiSnapshots = &uiSnapshots;
+	MainLoop loop(services, startup, profileSettleMs);
+	loop.setSettingsStatus(settingsStatus);
+
+	// event loop, until SteamVR quits or we're asked to stop
+	while (!stopRequested && !runtime->quitRequested())
 	{
 		// Get current time
 		long currentTime = getCurrentTimeMillis();
 
-		// Fetch resolution and target fps
-		float newRes = vr::VRSettings()->GetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float);
-		float lastRes = newRes;
-		float targetFps = std::round(vr::VRSystem()->GetFloatTrackedDeviceProperty(0, Prop_DisplayFrequency_Float));
-		float targetFrametime = 1000 / targetFps;
-		float realTargetFrametime = targetFrametime;
-
-		// Get current frame
-		auto *frameTiming = new vr::Compositor_FrameTiming;
-		frameTiming->m_nSize = sizeof(Compositor_FrameTiming);
-		vr::VRCompositor()->GetFrameTiming(frameTiming);
-
-		// Get total GPU Frametime
-		float gpuTime = frameTiming->m_flTotalRenderGpuMs;
-		// Calculate total CPU Frametime
-		// https://github.com/Louka3000/OpenVR-Dynamic-Resolution/issues/18#issuecomment-1833105172
-		float cpuTime = frameTiming->m_flCompositorRenderCpuMs									 // Compositor
-						+ (frameTiming->m_flNewFrameReadyMs - frameTiming->m_flNewPosesReadyMs); // Application & Late Start
-
-		// How many times the current frame repeated (>1 = reprojecting)
-		uint32_t frameShown = frameTiming->m_nNumFramePresents;
-		// Reason reprojection is happening
-		uint32_t reprojectionFlag = frameTiming->m_nReprojectionFlags;
-
-		// Adjust the CPU time off GPU reprojection.
-		float realCpuTime = cpuTime;
-		cpuTime *= std::min((double)frameShown, floor(gpuTime / targetFrametime) + 1);
-
-		// Calculate average GPU frametime
-		gpuTimes.push_front(gpuTime);
-		if (gpuTimes.size() > dataAverageSamples)
-			gpuTimes.pop_back();
-		float averageGpuTime = 0;
-		for (float time : gpuTimes)
-			averageGpuTime += time;
-		averageGpuTime /= gpuTimes.size();
-		// Caculate average CPU frametime
-		cpuTimes.push_front(cpuTime);
-		if (cpuTimes.size() > dataAverageSamples)
-			cpuTimes.pop_back();
-		float averageCpuTime = 0;
-		for (float time : cpuTimes)
-			averageCpuTime += time;
-		averageCpuTime /= cpuTimes.size();
-
-		// Estimated current FPS
-		uint32_t currentFps = targetFps / frameShown;
-		if (averageCpuTime > targetFrametime)
-			currentFps /= fmod(averageCpuTime, targetFrametime) / targetFrametime + 1;
-
-		// Double the target frametime if the user wants to,
-		// or if CPU Frametime is double the target frametime,
-		// or if preferReprojection is true and CPU Frametime is greated than targetFrametime.
-		if ((((averageCpuTime > targetFrametime && preferReprojection) || averageCpuTime / 2 > targetFrametime) && !ignoreCpuTime) || alwaysReproject)
+		// Auto-start was set in the background
+		if (autoStart.valid() && autoStart.wait_for(0ms) == std::future_status::ready)
 		{
-			targetFrametime *= 2;
-		}
-
-		// Get VRAM usage
-		float vramUsage = 0.0;
-
-		// Resolution handling
-		if (currentTime - resChangeDelayMs > lastChangeTime)
-		{
-			lastChangeTime = currentTime;
-
-			if (!VROverlay()->IsDashboardVisible())
+			autoStart.get();
+			loop.setAutoStartStatus(autoStartStatus);
+			if (uiHeadless() && !autoStartStatus.empty())
 			{
-
-				// Adjust resolution
-				if ((averageCpuTime > minCpuTimeThreshold || vramOnlyMode))
-				{
-					// Frametime
-					if (averageGpuTime < targetFrametime * resIncreaseThreshold && vramUsage < vramTarget && !vramOnlyMode)
-					{
-						// Increase resolution
-						newRes += ((((targetFrametime * resIncreaseThreshold) - averageGpuTime) / targetFrametime) *
-								   resIncreaseScale) +
-								  resIncreaseMin;
-					}
-					else if (averageGpuTime > targetFrametime * resDecreaseThreshold && !vramOnlyMode)
-					{
-						// Decrease resolution
-						newRes -= (((averageGpuTime - (targetFrametime * resDecreaseThreshold)) / targetFrametime) *
-								   resDecreaseScale) +
-								  resDecreaseMin;
-					}
-
-					// VRAM
-					if (vramUsage > vramLimit)
-					{
-						// Force the resolution to decrease when the vram limit is reached
-						newRes -= resDecreaseMin;
-					}
-					else if (vramOnlyMode && newRes < initialRes && vramUsage < vramTarget)
-					{
-						// When in VRAM-only mode, make sure the res goes back up when possible.
-						newRes = std::min(initialRes, newRes + resIncreaseMin);
-					}
-
-					// Clamp the new resolution
-					newRes = std::clamp(newRes, minRes, maxRes);
-				}
-				else if (resetOnThreshold && lastRes != initialRes && averageCpuTime < minCpuTimeThreshold && !vramOnlyMode)
-				{
-					// Reset to initialRes because CPU time fell below the threshold
-					newRes = initialRes;
-				}
-
-				if (newRes != lastRes)
-				{
-					// Sets the new resolution
-					vr::VRSettings()->SetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float, newRes);
-				}
+				fmt::print("{}\n", autoStartStatus);
+				std::fflush(stdout);
 			}
 		}
 
-		// Clear console
-		clear();
-		getmaxyx(stdscr, rows, cols);
-
-		// Title
-		attron(A_UNDERLINE);
-		mvprintw(0, 0, "%s", fmt::format("OpenVR Dynamic Resolution {}", version).c_str());
-		attroff(A_UNDERLINE);
+		// The simulated compositor runs in real time here
+		if (sim)
+			sim->advance(double(currentTime - startTime) - sim->nowMs());
 
-		// Settings status
-		if (settingsLoaded)
-			mvprintw(1, 0, "%s", fmt::format("settings.ini successfully loaded").c_str());
-		else
-			mvprintw(1, 0, "%s", fmt::format("Error loading settings.ini").c_str());
-
-		// HMD Hz
-		mvprintw(3, 0, "%s", fmt::format("HMD Hz: {} fps", std::to_string(int(targetFps))).c_str());
+		TickResult tick = loop.tick(currentTime);
 
-		// Target frametime
-		if (!vramOnlyMode)
-		{
-			mvprintw(4, 0, "%s", fmt::format("HMD Hz target frametime: {} ms", std::to_string(realTargetFrametime).substr(0, 4)).c_str());
-			mvprintw(5, 0, "%s", fmt::format("Adjusted target frametime: {} ms", std::to_string(targetFrametime).substr(0, 4)).c_str());
-		}
-		else
-		{
-			mvprintw(4, 0, "%s", "Adjusted target frametime: Disabled");
-			mvprintw(5, 0, "%s", "HMD Hz target frametime: Disabled");
-		}
-
-		// VRAM target and limit
-		if (vramMonitorEnabled)
-		{
-			mvprintw(6, 0, "%s", fmt::format("VRAM target: {}%", std::to_string(vramTarget * 100).substr(0, 4)).c_str());
-			mvprintw(7, 0, "%s", fmt::format("VRAM limit: {}%", std::to_string(vramLimit * 100).substr(0, 4)).c_str());
-		}
-		else
+		// Without a window, only report the changes
+		if (uiHeadless())
 		{
-			mvprintw(6, 0, "%s", fmt::format("VRAM target: Disabled").c_str());
-			mvprintw(7, 0, "%s", fmt::format("VRAM limit: Disabled").c_str());
+			if (tick.settingsChanged)
+				fmt::print("{}\n", loop.settingsStatus());
+			if (tick.decision.changed)
+				fmt::print("Resolution {}% -> {}% ({})\n", int(tick.previousRes * 100), int(tick.decision.newRes * 100), actionName(tick.decision.action));
+			std::fflush(stdout);
 		}
 
-		// FPS and frametimes
-		mvprintw(9, 0, "%s", fmt::format("FPS: {} fps", std::to_string(currentFps)).c_str());
-		mvprintw(10, 0, "%s", fmt::format("GPU frametime: {} ms", std::to_string(averageGpuTime).substr(0, 4)).c_str());
-		mvprintw(11, 0, "%s", fmt::format("CPU frametime: {} ms", std::to_string(averageCpuTime).substr(0, 4)).c_str());
-		mvprintw(12, 0, "%s", fmt::format("Raw CPU frametime: {} ms", std::to_string(realCpuTime).substr(0, 4)).c_str());
-
-		// VRAM usage
-		if (vramMonitorEnabled)
-			mvprintw(13, 0, "%s", fmt::format("VRAM usage: {}%", std::to_string(vramUsage * 100).substr(0, 4)).c_str());
-		else
-			mvprintw(13, 0, "%s", fmt::format("VRAM usage: Disabled").c_str());
+		// ZZzzzz
+		sleepUnlessStopped(tick.sleepMs);
+	}
 
-		// Reprojecting status
-		if (frameShown > 1)
-		{
-			std::string reason = fmt::format("Other [{}]", reprojectionFlag).c_str();
-			if (reprojectionFlag == 20)
-				reason = "CPU";
-			else if (reprojectionFlag == 276)
-				reason = "GPU";
+	long endTime = getCurrentTimeMillis();
+	settingsWatcher.stop();
+	uiThread.stop();
+	uiEnd();
+	recorder.close();
+	metrics.close();
 
-			mvprintw(15, 0, fmt::format("Reprojecting: Yes ({}x, {})", frameShown, reason).c_str());
-		}
+	// Keep what the session looked like, to compare settings across sessions
+	if (!settings.reportFile.empty())
+	{
+		ReportHeader header;
+		header.version = version;
+		header.startMs = startTime;
+		header.endMs = endTime;
+		header.runtime = simulate ? "simulated " + args::get(simulate) : "SteamVR";
+		if (appendReport(settings.reportFile, header, settings.controller, loop.controller().sessionReport()))
+			fmt::print("Session report appended to {}\n", settings.reportFile);
 		else
-		{
-			mvprintw(15, 0, "Reprojecting: No");
-		}
-
-		// Current resolution
-		attron(A_BOLD);
-		mvprintw(17, 0, "%s", fmt::format("Resolution = {}%", std::to_string(int(newRes * 100))).c_str());
-		attroff(A_BOLD);
-
-		// Displays the information
-		refresh();
-
-		// Calculate how long to sleep for
-		long sleepTime = dataPullDelayMs;
-		if (dataPullDelayMs < currentTime - lastChangeTime && resChangeDelayMs < currentTime - lastChangeTime)
-		{
-			sleepTime = (currentTime - lastChangeTime) - resChangeDelayMs;
-		}
-		else if (resChangeDelayMs < dataPullDelayMs)
-		{
-			sleepTime = resChangeDelayMs;
-		}
-
-		// ZZzzzz
-		std::this_thread::sleep_for(std::chrono::milliseconds(sleepTime));
+			std::cerr << "Could not write the session report to " << settings.reportFile << std::endl;
+		std::fflush(stdout);
 	}
 
-	// TODO actually be able to get out of the while loop
-
+	// SteamVR goes last, once nothing talks to it anymore
+	runtime.reset();
+	system.reset();
+#if defined(_WIN32)
+	stopped = true;
+#endif
 	return 0;
 }
@@ -0,0 +1,352 @@
+#include "mainloop.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <memory>
+
+#include "reprojection.hpp"
+#include "runtime.hpp"
+#include "settings.hpp"
+#include "settingswatch.hpp"
+#include "thermal.hpp"
+#include "trace.hpp"
+#include "vram.hpp"
+
+// k_unMaxApplicationKeyLength
+static constexpr uint32_t maxApplicationKeyLength = 128;
+
+static const float percentiles[3] = {50, 95, 99};
+
+MainLoop::MainLoop(const LoopServices &services, const StartupInfo &startup, long profileSettleMs)
+	: services(services), startup(startup), resController(services.settings->controller), frameIngest(*services.runtime),
+	  profileTracker(*services.profiles, profileSettleMs), scheduler(services.settings->controller)
+{
+}
+
+bool MainLoop::reloadSettings()
+{
+	std::unique_ptr<SettingsUpdate> update = services.settingsWatcher->take();
+	if (!update)
+		return false;
+
+	Settings &settings = *services.settings;
+	if (update->valid)
+	{
+		// These only take effect on the next start
+		Settings &next = update->settings;
+		next.autoStart = settings.autoStart;
+		next.minimizeOnStart = settings.minimizeOnStart;
+		next.appProfiles = settings.appProfiles;
+		next.waitForSteamVR = settings.waitForSteamVR;
+		next.controller.initialRes = settings.controller.initialRes;
+		next.vramSysfsRoot = settings.vramSysfsRoot;
+		next.thermalSysfsRoot = settings.thermalSysfsRoot;
+		next.traceFile = settings.traceFile;
+		next.metricsSharedMemory = settings.metricsSharedMemory;
+		next.metricsSocket = settings.metricsSocket;
+		next.reportFile = settings.reportFile;
+
+		settings = next;
+		resController.setConfig(settings.controller);
+		scheduler.setConfig(settings.controller);
+		settingsMessage = "settings.ini reloaded";
+	}
+	else
+	{
+		settingsMessage = "settings.ini rejected: " + update->error;
+	}
+	return true;
+}
+
+bool MainLoop::changeApp(uint32_t pid, long currentTime, ControllerInput &input)
+{
+	const ControllerConfig &config = services.settings->controller;
+	Runtime &runtime = *services.runtime;
+
+	char appKey[maxApplicationKeyLength] = "";
+	if (pid == 0 || !runtime.getApplicationKey(pid, appKey, sizeof(appKey)))
+		appKey[0] = '\0';
+
+	warmStartRes = 0.0f;
+	if (const AppProfile *profile = profileTracker.changeApp(appKey, currentTime))
+	{
+		warmStartRes = std::clamp(profile->res, config.minRes, config.maxRes);
+		runtime.setSupersampleScale(warmStartRes);
+		input.currentRes = warmStartRes;
+
+		// The frames so far belong to the previous application
+		resController.reset(currentTime);
+		resController.restoreHitchEstimate(profile->hitch);
+		return false;
+	}
+
+	// Hitches depend on the game
+	resController.restoreHitchEstimate(HitchEstimate());
+	return true;
+}
+
+TickResult MainLoop::tick(long currentTime)
+{
+	TickResult result;
+	result.settingsChanged = reloadSettings();
+
+	const Settings &settings = *services.settings;
+	const ControllerConfig &config = settings.controller;
+	Runtime &runtime = *services.runtime;
+
+	// Refresh the cached runtime state
+	runtime.pollEvents();
+
+	// Fetch resolution and target fps
+	ControllerInput input;
+	input.timeMs = currentTime;
+	input.currentRes = runtime.getSupersampleScale();
+	input.displayHz = std::round(runtime.getDisplayFrequency());
+	input.dashboardVisible = runtime.isDashboardVisible();
+	input.basePixels = basePixelsFor(runtime, input.currentRes);
+
+	// Get VRAM usage
+	VramInfo vramInfo;
+	bool vramRead = config.vramMonitorEnabled && services.vram->read(vramInfo);
+	input.vramUsage = vramRead ? vramInfo.usage() : 0.0f;
+
+	// Get temperatures, clocks and power draw
+	bool thermalRead = config.thermalMonitorEnabled && services.thermal && services.thermal->read(input.thermal);
+
+	// Pull every frame presented since the last tick
+	uint32_t newFrames = frameIngest.poll();
+
+	// Another application started rendering
+	uint32_t pid = runtime.getSceneProcessId();
+	if (pid != scenePid && pid != 0)
+		resController.beginTransition(currentTime);
+	if (settings.appProfiles && pid != scenePid && !changeApp(pid, currentTime, input))
+		newFrames = 0;
+	scenePid = pid;
+
+	// Let the controller decide on the resolution
+	result.previousRes = input.currentRes;
+	result.decision = resController.update(input, frameIngest.frames(), newFrames);
+	const Decision &decision = result.decision;
+	if (decision.changed)
+	{
+		// Sets the new resolution
+		runtime.setSupersampleScale(decision.newRes);
+	}
+
+	// Remember what the application settled on
+	if (settings.appProfiles && profileTracker.observe(currentTime, decision.newRes, resController.averageGpuTime(), resController.averageCpuTime(), resController.hitches().estimate(), input.dashboardVisible) && services.profilesPath)
+		services.profiles->save(services.profilesPath);
+
+	// Calculate how long to sleep for
+	result.sleepMs = scheduler.next(resController, currentTime, decision.newRes, input.displayHz, input.dashboardVisible, pid != 0);
+
+	// Record what we saw and what we did with it
+	TraceRecorder &recorder = *services.recorder;
+	if (recorder.isOpen())
+	{
+		for (uint32_t i = 0; i < frameIngest.count(); i++)
+			recorder.recordFrame(frameIngest.frames()[i]);
+
+		TraceTick tick;
+		tick.timeMs = currentTime;
+		tick.currentRes = input.currentRes;
+		tick.newRes = decision.newRes;
+		tick.averageGpuTime = resController.averageGpuTime();
+		tick.averageCpuTime = resController.averageCpuTime();
+		tick.targetFrametime = resController.targetFrametime();
+		tick.action = uint32_t(decision.action);
+		recorder.recordTick(tick);
+	}
+
+	publishUi(input, decision, pid, vramRead, thermalRead, currentTime);
+	if (services.metrics->isOpen())
+		publishMetrics(input, decision, newFrames, currentTime);
+
+	return result;
+}
+
+// Publish what the window shows
+void MainLoop::publishUi(const ControllerInput &input, const Decision &decision, uint32_t pid, bool vramRead, bool thermalRead, long currentTime)
+{
+	const Settings &settings = *services.settings;
+	const ControllerConfig &config = settings.controller;
+	const ResolutionController &controller = resController;
+	const FrameSample &latest = frameIngest.latest();
+
+	ui = UiSnapshot();
+	ui.simulated = startup.simulated;
+	copyField(ui.settingsStatus, settingsMessage.c_str());
+	ui.startupMs = startup.startupMs;
+	ui.steamVrWaitMs = startup.steamVrWaitMs;
+	ui.initAttempts = startup.initAttempts;
+	copyField(ui.autoStartStatus, autoStartMessage.c_str());
+	ui.vramOnlyMode = config.vramOnlyMode;
+	ui.vramMonitorEnabled = config.vramMonitorEnabled;
+	ui.recording = services.recorder->isOpen();
+	copyField(ui.traceFile, settings.traceFile.c_str());
+	ui.droppedRecords = services.recorder->droppedRecords();
+	ui.displayHz = input.displayHz;
+	ui.realTargetFrametime = controller.realTargetFrametime();
+	ui.targetFrametime = controller.targetFrametime();
+	ui.vramTarget = config.vramTarget;
+	ui.vramLimit = config.vramLimit;
+	ui.pollRate = scheduler.pollRate();
+	ui.pollState = scheduler.state();
+	ui.averageGpuTime = controller.averageGpuTime();
+	ui.averageCpuTime = controller.averageCpuTime();
+	ui.rawCpuTime = controller.rawCpuTime();
+	for (int i = 0; i < 3; i++)
+	{
+		ui.gpuPercentiles[i] = controller.gpuStats().percentile(percentiles[i]);
+		ui.cpuPercentiles[i] = controller.cpuStats().percentile(percentiles[i]);
+	}
+	ui.vramRead = vramRead;
+	ui.vramUsage = input.vramUsage;
+	ui.appVramKnown = vramRead && services.vram->processUsage(pid, ui.appVramBytes);
+	ui.thermalMonitorEnabled = config.thermalMonitorEnabled;
+	ui.thermalRead = thermalRead;
+	ui.thermal = input.thermal;
+	const ThrottleDetector &throttle = controller.throttle();
+	ui.throttling = throttle.throttling();
+	ui.throttleReasons = throttle.reasons();
+	ui.throttleSeconds = (currentTime - throttle.enteredMs()) / 1000.0f;
+	ui.throttleEvents = throttle.events();
+	ui.throttleCeiling = controller.throttleCeiling();
+	ui.frameShown = std::max(latest.numFramePresents, 1u);
+	ui.reprojectionFlags = latest.reprojectionFlags;
+	const ReprojectionStats &reprojection = controller.reprojectionStats();
+	ui.cpuLimitedShare = reprojection.cpuLimitedShare();
+	ui.gpuLimitedShare = reprojection.gpuLimitedShare();
+	ui.throttledShare = reprojection.throttledShare();
+	ui.motionSmoothedShare = reprojection.motionSmoothedShare();
+	ui.cpuBound = controller.cpuBound();
+	ui.res = decision.newRes;
+	ui.modelEnabled = config.controllerMode == 1;
+	ui.modelReady = controller.gpuModel().ready();
+	if (ui.modelReady)
+	{
+		ui.modelFixedMs = float(controller.gpuModel().fixedMs());
+		ui.modelMsPerMpixel = float(controller.gpuModel().msPerPixel() * 1e6);
+	}
+	copyField(ui.appKey, profileTracker.appKey().c_str());
+	const HitchEstimate &hitch = controller.hitches().estimate();
+	ui.hitchFrames = hitch.missedFrames;
+	ui.hitchSpikeMs = hitch.spikeMs;
+	ui.hitchRecoveryMs = hitch.recoveryMs;
+	ui.hitchSamples = hitch.samples;
+	ui.skippedChanges = controller.skippedChanges();
+	ui.predictionEnabled = config.predictiveDecrease;
+	ui.gpuTrendPerSecond = controller.gpuTrendStats().slopePerSecond();
+	ui.predictionsFired = controller.predictionsFired();
+	ui.predictionsConfirmed = controller.predictionsConfirmed();
+	ui.predictionsMissed = controller.predictionsMissed();
+	ui.warmStartRes = warmStartRes;
+	const RateModeSelector &rateMode = controller.rateModes();
+	ui.rateMode = rateMode.mode();
+	ui.rateModeSeconds = (currentTime - rateMode.enteredMs()) / 1000.0f;
+	ui.rateModeSwitches = rateMode.switches();
+	ui.nativeResEstimate = controller.nativeResEstimate();
+	ui.halfResEstimate = controller.halfResEstimate();
+	const PipelineStats &pipeline = controller.pipelineStats();
+	for (size_t i = 0; i < stageCount; i++)
+		ui.stageAverages[i] = pipeline.stage(Stage(i)).average();
+	ui.appCpuP99 = pipeline.stage(Stage::AppCpu).percentile(99);
+	ui.droppedFrames = pipeline.droppedFrames();
+	ui.misPresentedFrames = pipeline.misPresentedFrames();
+	ui.sessionState = controller.sessionState();
+	uint64_t sessionTotal = 0;
+	for (size_t i = 0; i < sessionStateCount; i++)
+		sessionTotal += controller.sessionFrames(SessionState(i));
+	for (size_t i = 0; i < sessionStateCount; i++)
+		ui.sessionShares[i] = sessionTotal > 0 ? float(controller.sessionFrames(SessionState(i))) / sessionTotal : 0.0f;
+	ui.outlierFrames = controller.outlierFrames();
+
+	// Estimated current FPS
+	ui.currentFps = uint32_t(input.displayHz) / ui.frameShown;
+	if (ui.averageCpuTime > ui.realTargetFrametime)
+		ui.currentFps /= fmod(ui.averageCpuTime, ui.realTargetFrametime) / ui.realTargetFrametime + 1;
+
+	services.uiSnapshots->store(ui);
+}
+
+// Publish the live metrics, from what the window shows
+void MainLoop::publishMetrics(const ControllerInput &input, const Decision &decision, uint32_t newFrames, long currentTime)
+{
+	const ResolutionController &controller = resController;
+	const PipelineStats &pipeline = controller.pipelineStats();
+	const HitchEstimate &hitch = controller.hitches().estimate();
+
+	MetricsSample &m = metricsSample;
+	m.timeMs = currentTime;
+	m.displayHz = input.displayHz;
+	m.realTargetFrametime = ui.realTargetFrametime;
+	m.targetFrametime = ui.targetFrametime;
+	m.averageGpuTime = ui.averageGpuTime;
+	m.averageCpuTime = ui.averageCpuTime;
+	std::copy(std::begin(ui.gpuPercentiles), std::end(ui.gpuPercentiles), m.gpuPercentiles);
+	std::copy(std::begin(ui.cpuPercentiles), std::end(ui.cpuPercentiles), m.cpuPercentiles);
+	for (size_t i = 0; i < stageCount; i++)
+	{
+		const FrametimeStats &stage = pipeline.stage(Stage(i));
+		m.stageAverages[i] = stage.average();
+		for (int j = 0; j < 3; j++)
+			m.stagePercentiles[i][j] = stage.percentile(percentiles[j]);
+	}
+	m.resolution = decision.newRes;
+	m.vramUsage = input.vramUsage;
+	m.thermal = input.thermal;
+	m.throttling = ui.throttling;
+	m.throttleCeiling = ui.throttleCeiling;
+	m.throttleEvents = ui.throttleEvents;
+	m.sessionState = ui.sessionState;
+	for (size_t i = 0; i < sessionStateCount; i++)
+		m.sessionFrames[i] = controller.sessionFrames(SessionState(i));
+	m.outlierFrames = ui.outlierFrames;
+	m.hitchFrames = hitch.missedFrames;
+	m.hitchSpikeMs = hitch.spikeMs;
+	m.hitchRecoveryMs = hitch.recoveryMs;
+	for (uint32_t i = 0; i < newFrames; i++)
+	{
+		const FrameSample &frame = frameIngest.frames()[i];
+		if (frame.numFramePresents > 1)
+			m.reprojectedFrames++;
+		m.droppedFrames += frame.numDroppedFrames;
+		m.misPresentedFrames += frame.numMisPresented;
+		ReprojectionInfo reason = decodeReprojection(frame.reprojectionFlags);
+		m.cpuLimitedFrames += reason.cpuLate();
+		m.gpuLimitedFrames += reason.gpuLimited;
+		m.throttledFrames += reason.throttledFrames > 0;
+		m.motionSmoothedFrames += reason.motionSmoothed;
+	}
+	m.frames += newFrames;
+	m.missedFrames = frameIngest.missedFrames();
+	if (decision.changed)
+		m.resolutionChanges++;
+	m.skippedChanges = controller.skippedChanges();
+	m.cpuBound = ui.cpuBound;
+	m.gpuTrendPerSecond = ui.gpuTrendPerSecond;
+	m.predictionsFired = ui.predictionsFired;
+	m.predictionsConfirmed = ui.predictionsConfirmed;
+	m.predictionsMissed = ui.predictionsMissed;
+	m.halfRate = ui.rateMode == RateMode::Half;
+	m.rateModeSwitches = ui.rateModeSwitches;
+	m.nativeResEstimate = ui.nativeResEstimate;
+	m.halfResEstimate = ui.halfResEstimate;
+	if (decision.action != Action::None)
+		m.decisions[size_t(decision.action)]++;
+	if (const IpcStats *ipc = services.runtime->ipcStats())
+	{
+		for (size_t i = 0; i < ipcCallCount; i++)
+		{
+			const LatencyStats &call = (*ipc)[i];
+			m.ipcCalls[i] = call.count();
+			m.ipcMeanUs[i] = float(call.meanUs());
+			m.ipcP99Us[i] = float(call.percentileUs(99));
+			m.ipcMaxUs[i] = float(call.maxUs());
+		}
+	}
+	m.coalescedWrites = services.runtime->coalescedWrites();
+	services.metrics->publish(m);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "controller.hpp"
+#include "ingest.hpp"
+#include "metrics.hpp"
+#include "profiles.hpp"
+#include "scheduler.hpp"
+#include "seqlock.hpp"
+#include "uiformat.hpp"
+
+class Runtime;
+struct Settings;
+class SettingsWatcher;
+class TraceRecorder;
+class ThermalSampler;
+class VramProvider;
+
+// What the loop works with, owned by whoever runs it
+struct LoopServices
+{
+	Runtime *runtime = nullptr;
+	// Replaced in place when settings.ini is reloaded
+	Settings *settings = nullptr;
+	SettingsWatcher *settingsWatcher = nullptr;
+	VramProvider *vram = nullptr;
+	// Null when there are no sensors to read
+	ThermalSampler *thermal = nullptr;
+	ProfileStore *profiles = nullptr;
+	// Where the profiles are saved (null to keep them in memory)
+	const char *profilesPath = nullptr;
+	TraceRecorder *recorder = nullptr;
+	MetricsPublisher *metrics = nullptr;
+	Seqlock<UiSnapshot> *uiSnapshots = nullptr;
+};
+
+// Shown in the window, unchanged while running
+struct StartupInfo
+{
+	bool simulated = false;
+	float startupMs = 0.0f;
+	float steamVrWaitMs = 0.0f;
+	int initAttempts = 0;
+};
+
+// What a tick did, for the caller to report and wait on
+struct TickResult
+{
+	Decision decision;
+	// Resolution before the decision
+	float previousRes = 0.0f;
+	// settings.ini was reloaded or rejected, see settingsStatus()
+	bool settingsChanged = false;
+	// Until the next tick
+	long sleepMs = 0;
+};
+
+// One tick of the main loop: settings reload, runtime state, frames, the controller's
+// decision, profiles, trace, window snapshot and metrics. The program and microbench
+// both run it, so what's measured is what runs.
+class MainLoop
+{
+public:
+	MainLoop(const LoopServices &services, const StartupInfo &startup, long profileSettleMs);
+
+	TickResult tick(long currentTime);
+
+	// Shown in the window once the background auto-start setup is done
+	void setAutoStartStatus(const std::string &status) { autoStartMessage = status; }
+	void setSettingsStatus(const std::string &status) { settingsMessage = status; }
+	const std::string &settingsStatus() const { return settingsMessage; }
+
+	const ResolutionController &controller() const { return resController; }
+
+private:
+	// Switches to the edited settings, keeping the current resolution and frame history
+	bool reloadSettings();
+	// Another application started rendering: hold decisions while it loads, and warm start
+	// from its profile. Returns false when the frames so far belong to the previous one.
+	bool changeApp(uint32_t pid, long currentTime, ControllerInput &input);
+	void publishUi(const ControllerInput &input, const Decision &decision, uint32_t pid, bool vramRead, bool thermalRead, long currentTime);
+	void publishMetrics(const ControllerInput &input, const Decision &decision, uint32_t newFrames, long currentTime);
+
+	LoopServices services;
+	StartupInfo startup;
+
+	ResolutionController resController;
+	FrameIngest frameIngest;
+	ProfileTracker profileTracker;
+	PollScheduler scheduler;
+
+	uint32_t scenePid = 0;
+	float warmStartRes = 0.0f;
+	std::string settingsMessage;
+	std::string autoStartMessage;
+	// Rebuilt every tick
+	UiSnapshot ui;
+	// The counters add up across ticks
+	MetricsSample metricsSample;
+};
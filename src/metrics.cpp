@@ -0,0 +1,338 @@
+#include "metrics.hpp"
+
+#include <cstring>
+#include <new>
+#include <fmt/format.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// How long a connection gets to send its request before the metrics are sent anyway
+static constexpr int requestTimeoutMs = 100;
+
+static void appendMetric(std::string &out, const char *name, const char *type, const char *help)
+{
+	fmt::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+void formatPrometheus(const MetricsSample &s, std::string &out)
+{
+	static const char *percentileNames[3] = {"p50", "p95", "p99"};
+	auto it = std::back_inserter(out);
+
+	appendMetric(out, "ovdr_display_hz", "gauge", "Refresh rate of the HMD");
+	fmt::format_to(it, "ovdr_display_hz {}\n", s.displayHz);
+
+	appendMetric(out, "ovdr_target_frametime_ms", "gauge", "Frametime of the refresh rate (real) and the one the GPU is held to (adjusted)");
+	fmt::format_to(it, "ovdr_target_frametime_ms{{kind=\"real\"}} {}\n", s.realTargetFrametime);
+	fmt::format_to(it, "ovdr_target_frametime_ms{{kind=\"adjusted\"}} {}\n", s.targetFrametime);
+
+	appendMetric(out, "ovdr_gpu_frametime_ms", "gauge", "GPU frametime");
+	fmt::format_to(it, "ovdr_gpu_frametime_ms{{stat=\"average\"}} {}\n", s.averageGpuTime);
+	for (int i = 0; i < 3; i++)
+		fmt::format_to(it, "ovdr_gpu_frametime_ms{{stat=\"{}\"}} {}\n", percentileNames[i], s.gpuPercentiles[i]);
+
+	appendMetric(out, "ovdr_cpu_frametime_ms", "gauge", "CPU frametime");
+	fmt::format_to(it, "ovdr_cpu_frametime_ms{{stat=\"average\"}} {}\n", s.averageCpuTime);
+	for (int i = 0; i < 3; i++)
+		fmt::format_to(it, "ovdr_cpu_frametime_ms{{stat=\"{}\"}} {}\n", percentileNames[i], s.cpuPercentiles[i]);
+
+	appendMetric(out, "ovdr_resolution_ratio", "gauge", "Supersample scale (1 = 100%)");
+	fmt::format_to(it, "ovdr_resolution_ratio {}\n", s.resolution);
+
+	appendMetric(out, "ovdr_vram_usage_ratio", "gauge", "Share of the VRAM in use");
+	fmt::format_to(it, "ovdr_vram_usage_ratio {}\n", s.vramUsage);
+
+	appendMetric(out, "ovdr_temperature_celsius", "gauge", "Temperature of the GPU and the CPU package (0 = unavailable)");
+	fmt::format_to(it, "ovdr_temperature_celsius{{device=\"gpu\"}} {}\n", s.thermal.gpuTempC);
+	fmt::format_to(it, "ovdr_temperature_celsius{{device=\"cpu\"}} {}\n", s.thermal.cpuTempC);
+
+	appendMetric(out, "ovdr_clock_mhz", "gauge", "Current and highest clock of the GPU and the fastest CPU core (0 = unavailable)");
+	fmt::format_to(it, "ovdr_clock_mhz{{device=\"gpu\",stat=\"current\"}} {}\n", s.thermal.gpuClockMhz);
+	fmt::format_to(it, "ovdr_clock_mhz{{device=\"gpu\",stat=\"max\"}} {}\n", s.thermal.gpuMaxClockMhz);
+	fmt::format_to(it, "ovdr_clock_mhz{{device=\"cpu\",stat=\"current\"}} {}\n", s.thermal.cpuClockMhz);
+	fmt::format_to(it, "ovdr_clock_mhz{{device=\"cpu\",stat=\"max\"}} {}\n", s.thermal.cpuMaxClockMhz);
+
+	appendMetric(out, "ovdr_gpu_power_watts", "gauge", "Power drawn by the GPU and its cap (0 = unavailable)");
+	fmt::format_to(it, "ovdr_gpu_power_watts{{stat=\"current\"}} {}\n", s.thermal.gpuPowerW);
+	fmt::format_to(it, "ovdr_gpu_power_watts{{stat=\"cap\"}} {}\n", s.thermal.gpuPowerCapW);
+
+	appendMetric(out, "ovdr_throttling", "gauge", "Whether the hardware is throttling");
+	fmt::format_to(it, "ovdr_throttling {}\n", int(s.throttling));
+
+	appendMetric(out, "ovdr_throttle_ceiling_ratio", "gauge", "Highest resolution allowed while throttling (0 = not throttling)");
+	fmt::format_to(it, "ovdr_throttle_ceiling_ratio {}\n", s.throttleCeiling);
+
+	appendMetric(out, "ovdr_throttle_events_total", "counter", "Times the hardware started throttling");
+	fmt::format_to(it, "ovdr_throttle_events_total {}\n", s.throttleEvents);
+
+	appendMetric(out, "ovdr_hitch_missed_frames", "gauge", "Frames a resolution change is expected to miss, above the usual rate");
+	fmt::format_to(it, "ovdr_hitch_missed_frames {}\n", s.hitchFrames);
+
+	appendMetric(out, "ovdr_hitch_spike_ms", "gauge", "Expected GPU frametime spike after a resolution change");
+	fmt::format_to(it, "ovdr_hitch_spike_ms {}\n", s.hitchSpikeMs);
+
+	appendMetric(out, "ovdr_hitch_recovery_ms", "gauge", "Expected time for frames to run clean again after a resolution change");
+	fmt::format_to(it, "ovdr_hitch_recovery_ms {}\n", s.hitchRecoveryMs);
+
+	appendMetric(out, "ovdr_frames_total", "counter", "Compositor frames seen");
+	fmt::format_to(it, "ovdr_frames_total {}\n", s.frames);
+
+	appendMetric(out, "ovdr_reprojected_frames_total", "counter", "Frames presented more than once");
+	fmt::format_to(it, "ovdr_reprojected_frames_total {}\n", s.reprojectedFrames);
+
+	appendMetric(out, "ovdr_dropped_frames_total", "counter", "Frames the compositor dropped");
+	fmt::format_to(it, "ovdr_dropped_frames_total {}\n", s.droppedFrames);
+
+	appendMetric(out, "ovdr_mispresented_frames_total", "counter", "Frames the compositor reported as mispresented");
+	fmt::format_to(it, "ovdr_mispresented_frames_total {}\n", s.misPresentedFrames);
+
+	appendMetric(out, "ovdr_stage_ms", "gauge", "Time spent in each stage of the frames, as the compositor reports it");
+	for (size_t i = 0; i < stageCount; i++)
+	{
+		const char *stage = stageName(Stage(i));
+		fmt::format_to(it, "ovdr_stage_ms{{stage=\"{}\",stat=\"average\"}} {}\n", stage, s.stageAverages[i]);
+		fmt::format_to(it, "ovdr_stage_ms{{stage=\"{}\",stat=\"p50\"}} {}\n", stage, s.stagePercentiles[i][0]);
+		fmt::format_to(it, "ovdr_stage_ms{{stage=\"{}\",stat=\"p95\"}} {}\n", stage, s.stagePercentiles[i][1]);
+		fmt::format_to(it, "ovdr_stage_ms{{stage=\"{}\",stat=\"p99\"}} {}\n", stage, s.stagePercentiles[i][2]);
+	}
+
+	appendMetric(out, "ovdr_late_frames_total", "counter", "Frames the compositor reported as late, by reason");
+	fmt::format_to(it, "ovdr_late_frames_total{{reason=\"cpu\"}} {}\n", s.cpuLimitedFrames);
+	fmt::format_to(it, "ovdr_late_frames_total{{reason=\"gpu\"}} {}\n", s.gpuLimitedFrames);
+	fmt::format_to(it, "ovdr_late_frames_total{{reason=\"throttled\"}} {}\n", s.throttledFrames);
+	fmt::format_to(it, "ovdr_late_frames_total{{reason=\"motion_smoothed\"}} {}\n", s.motionSmoothedFrames);
+
+	appendMetric(out, "ovdr_session_state", "gauge", "What the session is doing, only in-app frames drive decisions");
+	for (size_t i = 0; i < sessionStateCount; i++)
+		fmt::format_to(it, "ovdr_session_state{{state=\"{}\"}} {}\n", sessionStateName(SessionState(i)), int(s.sessionState == SessionState(i)));
+
+	appendMetric(out, "ovdr_session_frames_total", "counter", "Frames by the state of the session they were rendered in");
+	for (size_t i = 0; i < sessionStateCount; i++)
+		fmt::format_to(it, "ovdr_session_frames_total{{state=\"{}\"}} {}\n", sessionStateName(SessionState(i)), s.sessionFrames[i]);
+
+	appendMetric(out, "ovdr_outlier_frames_total", "counter", "In-app frames left out of the averages for being dropped or spiking");
+	fmt::format_to(it, "ovdr_outlier_frames_total {}\n", s.outlierFrames);
+
+	appendMetric(out, "ovdr_cpu_bound", "gauge", "Whether most of the recent frames were late on the CPU rather than the GPU");
+	fmt::format_to(it, "ovdr_cpu_bound {}\n", int(s.cpuBound));
+
+	appendMetric(out, "ovdr_missed_frames_total", "counter", "Frames that fell out of the ingest buffer between two polls");
+	fmt::format_to(it, "ovdr_missed_frames_total {}\n", s.missedFrames);
+
+	appendMetric(out, "ovdr_resolution_changes_total", "counter", "Resolution changes applied");
+	fmt::format_to(it, "ovdr_resolution_changes_total {}\n", s.resolutionChanges);
+
+	appendMetric(out, "ovdr_gpu_trend_ms_per_second", "gauge", "Change of the GPU frametime per second at the current resolution");
+	fmt::format_to(it, "ovdr_gpu_trend_ms_per_second {}\n", s.gpuTrendPerSecond);
+
+	appendMetric(out, "ovdr_predictions_total", "counter", "Early decreases from the GPU frametime trend, by whether the predicted rise came");
+	fmt::format_to(it, "ovdr_predictions_total{{outcome=\"confirmed\"}} {}\n", s.predictionsConfirmed);
+	fmt::format_to(it, "ovdr_predictions_total{{outcome=\"missed\"}} {}\n", s.predictionsMissed);
+	fmt::format_to(it, "ovdr_predictions_total{{outcome=\"pending\"}} {}\n", s.predictionsFired - s.predictionsConfirmed - s.predictionsMissed);
+
+	appendMetric(out, "ovdr_half_rate", "gauge", "Whether the target frametime is set for half the HMD refresh rate");
+	fmt::format_to(it, "ovdr_half_rate {}\n", int(s.halfRate));
+
+	appendMetric(out, "ovdr_rate_mode_switches_total", "counter", "Switches between native and half rate");
+	fmt::format_to(it, "ovdr_rate_mode_switches_total {}\n", s.rateModeSwitches);
+
+	appendMetric(out, "ovdr_sustainable_resolution", "gauge", "Resolution the GPU could sustain at each rate (0 = unknown)");
+	fmt::format_to(it, "ovdr_sustainable_resolution{{rate=\"native\"}} {}\n", s.nativeResEstimate);
+	fmt::format_to(it, "ovdr_sustainable_resolution{{rate=\"half\"}} {}\n", s.halfResEstimate);
+
+	appendMetric(out, "ovdr_skipped_changes_total", "counter", "Resolution increases skipped because they would gain less than their hitch costs");
+	fmt::format_to(it, "ovdr_skipped_changes_total {}\n", s.skippedChanges);
+
+	appendMetric(out, "ovdr_decisions_total", "counter", "Resolution decisions taken, by action");
+	for (size_t i = size_t(Action::None) + 1; i < actionCount; i++)
+		fmt::format_to(it, "ovdr_decisions_total{{action=\"{}\"}} {}\n", actionName(Action(i)), s.decisions[i]);
+
+	appendMetric(out, "ovdr_ipc_calls_total", "counter", "Round-trips to the VR runtime, by call");
+	for (size_t i = 0; i < ipcCallCount; i++)
+		fmt::format_to(it, "ovdr_ipc_calls_total{{call=\"{}\"}} {}\n", ipcCallName(IpcCall(i)), s.ipcCalls[i]);
+
+	appendMetric(out, "ovdr_ipc_latency_us", "gauge", "Latency of the round-trips to the VR runtime, by call");
+	for (size_t i = 0; i < ipcCallCount; i++)
+	{
+		const char *call = ipcCallName(IpcCall(i));
+		fmt::format_to(it, "ovdr_ipc_latency_us{{call=\"{}\",stat=\"mean\"}} {}\n", call, s.ipcMeanUs[i]);
+		fmt::format_to(it, "ovdr_ipc_latency_us{{call=\"{}\",stat=\"p99\"}} {}\n", call, s.ipcP99Us[i]);
+		fmt::format_to(it, "ovdr_ipc_latency_us{{call=\"{}\",stat=\"max\"}} {}\n", call, s.ipcMaxUs[i]);
+	}
+
+	appendMetric(out, "ovdr_coalesced_writes_total", "counter", "Resolution writes superseded by a later one before they were sent");
+	fmt::format_to(it, "ovdr_coalesced_writes_total {}\n", s.coalescedWrites);
+}
+
+MetricsPublisher::~MetricsPublisher()
+{
+	close();
+}
+
+bool MetricsPublisher::openSharedMemory(const std::string &name)
+{
+	void *memory = nullptr;
+#ifdef _WIN32
+	HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(MetricsSegment), name.c_str());
+	if (!handle)
+		return false;
+	memory = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(MetricsSegment));
+	if (!memory)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+	mapping = handle;
+#else
+	int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+		return false;
+	if (ftruncate(fd, sizeof(MetricsSegment)) != 0)
+	{
+		::close(fd);
+		shm_unlink(name.c_str());
+		return false;
+	}
+	memory = mmap(nullptr, sizeof(MetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (memory == MAP_FAILED)
+	{
+		shm_unlink(name.c_str());
+		return false;
+	}
+#endif
+
+	segment = new (memory) MetricsSegment();
+	segment->version = metricsVersion;
+	segment->sampleSize = sizeof(MetricsSample);
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(segment->magic, metricsMagic, sizeof(metricsMagic));
+	shmName = name;
+	return true;
+}
+
+bool MetricsPublisher::openSocket(const std::string &path)
+{
+#ifdef _WIN32
+	return false;
+#else
+	sockaddr_un address{};
+	if (path.empty() || path.size() >= sizeof(address.sun_path))
+		return false;
+	address.sun_family = AF_UNIX;
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return false;
+
+	// A previous run may have left its socket behind
+	unlink(path.c_str());
+	if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, 4) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	listenFd = fd;
+	socketPath = path;
+	serving = true;
+	server = std::thread(&MetricsPublisher::serve, this);
+	return true;
+#endif
+}
+
+void MetricsPublisher::close()
+{
+	serving = false;
+	if (server.joinable())
+		server.join();
+#ifndef _WIN32
+	if (listenFd >= 0)
+	{
+		::close(listenFd);
+		unlink(socketPath.c_str());
+		listenFd = -1;
+	}
+#endif
+
+	if (segment)
+	{
+		segment->~MetricsSegment();
+#ifdef _WIN32
+		UnmapViewOfFile(segment);
+		CloseHandle(mapping);
+		mapping = nullptr;
+#else
+		munmap(segment, sizeof(MetricsSegment));
+		shm_unlink(shmName.c_str());
+#endif
+		segment = nullptr;
+	}
+}
+
+void MetricsPublisher::publish(const MetricsSample &sample)
+{
+	if (segment)
+		segment->sample.store(sample);
+	else
+		local.store(sample);
+}
+
+void MetricsPublisher::serve()
+{
+#ifndef _WIN32
+	std::string body;
+	std::string response;
+	MetricsSample sample;
+
+	while (serving)
+	{
+		// Wake up regularly to notice close()
+		pollfd listening{listenFd, POLLIN, 0};
+		if (poll(&listening, 1, 200) <= 0)
+			continue;
+		int client = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (client < 0)
+			continue;
+
+		// Read (and ignore) the HTTP request if the client sends one
+		pollfd request{client, POLLIN, 0};
+		if (poll(&request, 1, requestTimeoutMs) > 0)
+		{
+			char buffer[1024];
+			recv(client, buffer, sizeof(buffer), 0);
+		}
+
+		body.clear();
+		if (current().load(sample))
+			formatPrometheus(sample, body);
+
+		response.clear();
+		fmt::format_to(std::back_inserter(response),
+					   "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: {}\r\n\r\n", body.size());
+		response += body;
+
+		const char *data = response.data();
+		size_t remaining = response.size();
+		while (remaining > 0)
+		{
+			ssize_t sent = send(client, data, remaining, MSG_NOSIGNAL);
+			if (sent <= 0)
+				break;
+			data += sent;
+			remaining -= size_t(sent);
+		}
+		::close(client);
+	}
+#endif
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "controller.hpp"
+#include "latency.hpp"
+#include "seqlock.hpp"
+
+static constexpr size_t actionCount = size_t(Action::ThrottleDecrease) + 1;
+
+// Live state of the controller, published once per tick
+struct MetricsSample
+{
+	int64_t timeMs = 0;
+
+	float displayHz = 0.0f;
+	float realTargetFrametime = 0.0f;
+	float targetFrametime = 0.0f;
+
+	float averageGpuTime = 0.0f;
+	float gpuPercentiles[3] = {}; // p50, p95, p99
+	float averageCpuTime = 0.0f;
+	float cpuPercentiles[3] = {};
+	// Every stage of the frames, indexed by Stage
+	float stageAverages[stageCount] = {};
+	float stagePercentiles[stageCount][3] = {}; // p50, p95, p99
+
+	float resolution = 0.0f;
+	float vramUsage = 0.0f;
+
+	// Sensors (0 = unavailable), and whether the hardware is throttling
+	ThermalSample thermal;
+	bool throttling = false;
+	float throttleCeiling = 0.0f; // Highest resolution allowed while throttling
+	SessionState sessionState = SessionState::InApp;
+
+	// Running estimate of what a resolution change costs
+	float hitchFrames = 0.0f;
+	float hitchSpikeMs = 0.0f;
+	float hitchRecoveryMs = 0.0f;
+
+	// Most of the recent frames were late on the CPU
+	bool cpuBound = false;
+	// Change of the GPU frametime per second at the current resolution
+	float gpuTrendPerSecond = 0.0f;
+	// Targeting half the HMD refresh rate, and the resolution each rate could sustain
+	bool halfRate = false;
+	float nativeResEstimate = 0.0f;
+	float halfResEstimate = 0.0f;
+
+	// Counters since startup
+	uint64_t frames = 0;
+	uint64_t reprojectedFrames = 0;
+	uint64_t droppedFrames = 0;
+	uint64_t misPresentedFrames = 0;
+	// Reprojected frames by the reason the compositor gave
+	uint64_t cpuLimitedFrames = 0;
+	uint64_t gpuLimitedFrames = 0;
+	uint64_t throttledFrames = 0;
+	uint64_t motionSmoothedFrames = 0;
+	uint64_t missedFrames = 0; // Fell out of the ingest buffer between two polls
+	uint64_t resolutionChanges = 0;
+	uint64_t skippedChanges = 0; // Increases held back by their hitch cost
+	uint64_t rateModeSwitches = 0;
+	uint64_t throttleEvents = 0;
+	uint64_t sessionFrames[sessionStateCount] = {}; // Indexed by SessionState
+	uint64_t outlierFrames = 0; // In-app frames left out of the averages
+	// Early decreases from the GPU frametime trend, and whether the predicted rise came
+	uint64_t predictionsFired = 0;
+	uint64_t predictionsConfirmed = 0;
+	uint64_t predictionsMissed = 0;
+	uint64_t decisions[actionCount] = {}; // Indexed by Action, None isn't counted
+
+	// Round-trips to the VR runtime, indexed by IpcCall (all zero in simulation)
+	uint64_t ipcCalls[ipcCallCount] = {};
+	float ipcMeanUs[ipcCallCount] = {};
+	float ipcP99Us[ipcCallCount] = {};
+	float ipcMaxUs[ipcCallCount] = {};
+	uint64_t coalescedWrites = 0; // Resolution writes superseded before they were sent
+};
+
+// Shared memory layout. Readers check magic and version, then read the
+// sample through the seqlock protocol: wait for an even sequence, copy the
+// data words, and retry if the sequence changed meanwhile.
+static constexpr char metricsMagic[8] = {'O', 'V', 'D', 'R', 'M', 'E', 'T', '1'};
+static constexpr uint32_t metricsVersion = 9;
+
+struct MetricsSegment
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t sampleSize;
+	Seqlock<MetricsSample> sample;
+};
+
+// Prometheus text exposition of a sample
+void formatPrometheus(const MetricsSample &sample, std::string &out);
+
+// Publishes samples to a shared memory segment and/or a Unix socket serving
+// the Prometheus text format. The socket is served from its own thread, so
+// publish() costs one seqlock store.
+class MetricsPublisher
+{
+public:
+	MetricsPublisher() = default;
+	~MetricsPublisher();
+	MetricsPublisher(const MetricsPublisher &) = delete;
+	MetricsPublisher &operator=(const MetricsPublisher &) = delete;
+
+	// POSIX shm name (e.g. /ovdr-metrics) or Windows mapping name
+	bool openSharedMemory(const std::string &name);
+	// Path of a Unix socket, every connection gets the current metrics (not available on Windows)
+	bool openSocket(const std::string &path);
+	void close();
+
+	bool isOpen() const { return segment != nullptr || serving; }
+
+	void publish(const MetricsSample &sample);
+
+private:
+	void serve();
+	const Seqlock<MetricsSample> &current() const { return segment ? segment->sample : local; }
+
+	// Used when there is no shared memory segment
+	Seqlock<MetricsSample> local;
+
+	MetricsSegment *segment = nullptr;
+	std::string shmName;
+#ifdef _WIN32
+	void *mapping = nullptr;
+#endif
+
+	std::string socketPath;
+	int listenFd = -1;
+	std::atomic<bool> serving{false};
+	std::thread server;
+};
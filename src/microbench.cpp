@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+#include <fmt/core.h>
+#include <args.hxx>
+
+#include "closedloop.hpp"
+#include "controller.hpp"
+#include "ingest.hpp"
+#include "mainloop.hpp"
+#include "metrics.hpp"
+#include "profiles.hpp"
+#include "runtime.hpp"
+#include "scheduler.hpp"
+#include "settings.hpp"
+#include "settingswatch.hpp"
+#include "simruntime.hpp"
+#include "stats.hpp"
+#include "thermal.hpp"
+#include "trace.hpp"
+#include "uiformat.hpp"
+#include "vram.hpp"
+
+// Every allocation made by the program goes through here, so each benchmark can report allocs/op
+static std::atomic<uint64_t> allocations{0};
+static std::atomic<uint64_t> allocatedBytes{0};
+
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	std::free(p);
+}
+
+// Keeps the compiler from optimizing away results
+static volatile float sink;
+
+// Frametimes around 8ms with some noise and the occasional spike, the same for every run
+class SyntheticFrames
+{
+public:
+	FrameSample next()
+	{
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		float noise = float(state >> 40) / float(1 << 24) - 0.5f;
+		bool spike = (state >> 33) % 97 == 0;
+
+		FrameSample frame;
+		frame.frameIndex = ++index;
+		frame.systemTimeInSeconds = index / 90.0;
+		frame.totalRenderGpuMs = 8.0f + noise + (spike ? 6.0f : 0.0f);
+		frame.compositorRenderGpuMs = 0.5f;
+		frame.submitFrameMs = 5.0f + noise;
+		frame.compositorRenderCpuMs = 0.4f;
+		frame.compositorIdleCpuMs = 4.0f;
+		frame.numFramePresents = spike ? 2 : 1;
+		return frame;
+	}
+
+private:
+	uint64_t state = 1;
+	uint32_t index = 0;
+};
+
+// Serves synthetic frames to FrameIngest, as the compositor would between two polls
+class BenchRuntime : public Runtime
+{
+public:
+	// Frames presented since the previous poll
+	uint32_t framesPerPoll = 23;
+
+	bool getFrameTiming(FrameSample &frame) override
+	{
+		frame = history[(head + history.size() - 1) % history.size()];
+		return true;
+	}
+	uint32_t getFrameTimings(FrameSample *out, uint32_t count) override
+	{
+		for (uint32_t i = 0; i < framesPerPoll; i++)
+			history[(head + i) % history.size()] = synthetic.next();
+		head = (head + framesPerPoll) % history.size();
+		count = std::min<uint32_t>(count, uint32_t(history.size()));
+		for (uint32_t i = 0; i < count; i++)
+			out[i] = history[(head + history.size() - count + i) % history.size()];
+		return count;
+	}
+	float getSupersampleScale() override { return 1.0f; }
+	void setSupersampleScale(float) override {}
+	void getRecommendedRenderTargetSize(uint32_t &width, uint32_t &height) override
+	{
+		width = 2016;
+		height = 2240;
+	}
+	float getDisplayFrequency() override { return 90.0f; }
+	bool isDashboardVisible() override { return false; }
+	uint32_t getSceneProcessId() override { return 1; }
+	bool getApplicationKey(uint32_t, char *, uint32_t) override { return false; }
+
+private:
+	SyntheticFrames synthetic;
+	std::array<FrameSample, FrameIngest::capacity> history{};
+	size_t head = 0;
+};
+
+struct BenchResult
+{
+	std::string name;
+	uint64_t iterations = 0;
+	double nsPerOp = 0.0;
+	double allocsPerOp = 0.0;
+	double bytesPerOp = 0.0;
+};
+
+// Runs op in batches, doubling the batch until one takes at least minTime
+static BenchResult measure(const std::string &name, std::chrono::duration<double> minTime, const std::function<void(uint64_t)> &op)
+{
+	using clock = std::chrono::steady_clock;
+
+	// Warm up caches and lazily grown buffers, which aren't part of the steady state
+	for (uint64_t i = 0; i < 16; i++)
+		op(i);
+
+	BenchResult result;
+	result.name = name;
+	for (uint64_t batch = 1;; batch *= 2)
+	{
+		uint64_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+		uint64_t bytesBefore = allocatedBytes.load(std::memory_order_relaxed);
+		auto start = clock::now();
+		for (uint64_t i = 0; i < batch; i++)
+			op(i);
+		std::chrono::duration<double> elapsed = clock::now() - start;
+
+		if (elapsed >= minTime || batch >= (uint64_t(1) << 40))
+		{
+			result.iterations = batch;
+			result.nsPerOp = elapsed.count() * 1e9 / batch;
+			result.allocsPerOp = double(allocations.load(std::memory_order_relaxed) - allocationsBefore) / batch;
+			result.bytesPerOp = double(allocatedBytes.load(std::memory_order_relaxed) - bytesBefore) / batch;
+			return result;
+		}
+	}
+}
+
+// Snapshot with every row of the window in use
+static UiSnapshot busySnapshot()
+{
+	UiSnapshot ui;
+	ui.vramMonitorEnabled = true;
+	ui.recording = true;
+	copyField(ui.traceFile, "trace.bin");
+	ui.displayHz = 90.0f;
+	ui.realTargetFrametime = 11.1f;
+	ui.targetFrametime = 11.1f;
+	ui.vramTarget = 0.8f;
+	ui.vramLimit = 0.9f;
+	ui.pollRate = 4.0f;
+	ui.currentFps = 90;
+	ui.averageGpuTime = 8.2f;
+	ui.gpuPercentiles[0] = 8.1f;
+	ui.gpuPercentiles[1] = 9.4f;
+	ui.gpuPercentiles[2] = 12.8f;
+	ui.averageCpuTime = 5.1f;
+	ui.cpuPercentiles[0] = 5.0f;
+	ui.cpuPercentiles[1] = 5.9f;
+	ui.cpuPercentiles[2] = 7.3f;
+	ui.rawCpuTime = 5.2f;
+	ui.vramRead = true;
+	ui.vramUsage = 0.62f;
+	ui.appVramKnown = true;
+	ui.appVramBytes = uint64_t(3) << 30;
+	ui.frameShown = 2;
+	ui.gpuLimitedShare = 0.02f;
+	ui.res = 1.35f;
+	ui.modelEnabled = true;
+	ui.modelReady = true;
+	ui.modelFixedMs = 1.2f;
+	ui.modelMsPerMpixel = 1.9f;
+	copyField(ui.appKey, "steam.app.620980");
+	ui.warmStartRes = 1.3f;
+	ui.hitchFrames = 1.5f;
+	ui.hitchSpikeMs = 4.0f;
+	ui.hitchRecoveryMs = 150.0f;
+	ui.hitchSamples = 12;
+	ui.predictionEnabled = true;
+	ui.gpuTrendPerSecond = 0.3f;
+	ui.predictionsFired = 4;
+	ui.predictionsConfirmed = 3;
+	return ui;
+}
+
+// Runs the main loop's tick against the simulated compositor, in simulated time, with
+// the trace recorder and metrics publisher open and the window's formatting done in
+// between, and returns how many allocations the ticks after warmup made
+static uint64_t steadyStateAllocations(Settings settings, const std::string &settingsPath, const std::string &scenario, uint64_t ticks, uint64_t warmupTicks)
+{
+	SimConfig simConfig;
+	simScenario(scenario, 90.0f, simConfig);
+	SimRuntime sim(simConfig);
+	sim.setSupersampleScale(settings.controller.initialRes);
+
+	// Only the calls the loop makes, the watcher's thread isn't part of the tick
+	SettingsWatcher settingsWatcher(settingsPath, settings);
+	// The real providers when this machine has them, so their reads are checked too
+	std::unique_ptr<VramProvider> vram = createVramProvider(settings.vramSysfsRoot);
+	ThermalSampler thermal(settings.thermalSysfsRoot);
+	ProfileStore profiles;
+
+	// Names no other run uses
+	auto runId = std::chrono::steady_clock::now().time_since_epoch().count();
+	std::string tracePath = (std::filesystem::temp_directory_path() / fmt::format("microbench-{}.trace", runId)).string();
+	TraceRecorder recorder;
+	recorder.open(tracePath);
+	MetricsPublisher metrics;
+	metrics.openSharedMemory(fmt::format("/ovdr-microbench-{}", runId));
+
+	Seqlock<UiSnapshot> uiSnapshots;
+	UiScreen screen;
+
+	LoopServices services;
+	services.runtime = &sim;
+	services.settings = &settings;
+	services.settingsWatcher = &settingsWatcher;
+	services.vram = vram.get();
+	services.thermal = &thermal;
+	// Profiles are saved once each time an application settles, not every tick
+	services.profiles = &profiles;
+	services.recorder = &recorder;
+	services.metrics = &metrics;
+	services.uiSnapshots = &uiSnapshots;
+	StartupInfo startup;
+	startup.simulated = true;
+	MainLoop loop(services, startup, 10000);
+
+	uint64_t allocationsAfterWarmup = 0;
+	for (uint64_t tick = 0; tick < ticks; tick++)
+	{
+		if (tick == warmupTicks)
+			allocationsAfterWarmup = allocations.load(std::memory_order_relaxed);
+
+		TickResult result = loop.tick(long(sim.nowMs()));
+
+		// What the window's thread does with it
+		UiSnapshot ui;
+		uiSnapshots.load(ui);
+		formatUi(ui, "bench", screen);
+
+		sim.advance(double(result.sleepMs));
+	}
+	uint64_t allocated = allocations.load(std::memory_order_relaxed) - allocationsAfterWarmup;
+
+	recorder.close();
+	metrics.close();
+	std::remove(tracePath.c_str());
+	return allocated;
+}
+
+// Used when settings.ini can't be read
+static const char *fallbackSettings = "[Initialization]\n"
+									  "autoStart=1\n"
+									  "initialRes=100\n"
+									  "[Resolution change]\n"
+									  "minRes=70\n"
+									  "maxRes=250\n"
+									  "dataPullDelayMs=250\n"
+									  "resChangeDelayMs=1400\n"
+									  "resIncreaseThreshold=75\n"
+									  "resDecreaseThreshold=85\n"
+									  "dataAverageSamples=256\n"
+									  "dataWindowSamples=1024\n"
+									  "[Diagnostics]\n"
+									  "traceFile=\n";
+
+int main(int argc, char *argv[])
+{
+	args::ArgumentParser parser("Measures the per-tick cost of the statistics, decision, formatting and settings code.",
+								"Prints one JSON object with ns/op and allocations/op for each benchmark.");
+	args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
+	args::ValueFlag<std::string> settingsPath(parser, "file", "Settings file to parse", {'s', "settings"}, "settings.ini");
+	args::ValueFlag<std::string> filter(parser, "text", "Only run the benchmarks whose name contains this", {"filter"});
+	args::ValueFlag<double> minTime(parser, "seconds", "Minimum time measured per benchmark", {"min-time"}, 0.2);
+	args::ValueFlag<std::string> output(parser, "file", "Write the results to this file instead of stdout", {'o', "output"});
+	args::ValueFlag<uint64_t> steadyState(parser, "ticks", "Instead of timing, run this many simulated ticks of the main loop and fail if any allocates after warmup", {"steady-state"});
+	args::ValueFlag<std::string> scenario(parser, "name", "Scenario of the steady state run", {"scenario"}, "bursty");
+
+	try
+	{
+		parser.ParseCLI(argc, argv);
+	}
+	catch (const args::Help &)
+	{
+		std::cout << parser;
+		return 0;
+	}
+	catch (const args::Error &e)
+	{
+		std::cerr << e.what() << std::endl
+				  << parser;
+		return 1;
+	}
+
+	if (steadyState)
+	{
+		Settings settings;
+		if (!loadSettings(args::get(settingsPath).c_str(), settings))
+			fmt::print(stderr, "Could not load {}, using defaults\n", args::get(settingsPath));
+		SimConfig sim;
+		if (!simScenario(args::get(scenario), 90.0f, sim))
+		{
+			fmt::print(stderr, "Unknown scenario {}\n", args::get(scenario));
+			return 1;
+		}
+
+		// Long enough for every buffer to have grown to its final size
+		uint64_t ticks = args::get(steadyState);
+		uint64_t warmup = std::min<uint64_t>(ticks / 10, 1000);
+		uint64_t allocated = steadyStateAllocations(settings, args::get(settingsPath), args::get(scenario), ticks, warmup);
+		fmt::print("{{\"steadyStateTicks\": {}, \"warmupTicks\": {}, \"allocations\": {}}}\n", ticks - warmup, warmup, allocated);
+		if (allocated > 0)
+		{
+			fmt::print(stderr, "The main loop allocated {} times after warmup\n", allocated);
+			return 1;
+		}
+		return 0;
+	}
+
+	std::chrono::duration<double> runTime(args::get(minTime));
+	std::vector<BenchResult> results;
+	auto run = [&](const std::string &name, const std::function<void(uint64_t)> &op)
+	{
+		if (filter && name.find(args::get(filter)) == std::string::npos)
+			return;
+		results.push_back(measure(name, runTime, op));
+		fmt::print(stderr, "{:<28} {:>12.1f} ns/op {:>8.2f} allocs/op\n", name, results.back().nsPerOp, results.back().allocsPerOp);
+	};
+
+	// Sample ingestion and averaging, per frame
+	for (size_t window : {16, 64, 256, 1024, 4096})
+	{
+		FrametimeStats stats(window, window);
+		SyntheticFrames frames;
+		run(fmt::format("stats/push-average/{}", window), [&](uint64_t)
+			{
+				stats.push(frames.next().totalRenderGpuMs);
+				sink = stats.average(); });
+
+		run(fmt::format("stats/percentile/{}", window), [&](uint64_t i)
+			{ sink = stats.percentile(float(i % 100)); });
+	}
+
+	// Fetching one poll worth of frames
+	{
+		BenchRuntime runtime;
+		FrameIngest ingest(runtime);
+		run("ingest/poll", [&](uint64_t)
+			{ sink = float(ingest.poll()); });
+	}
+
+	// One controller step with a poll worth of new frames
+	{
+		ControllerConfig config;
+		ResolutionController controller(config);
+		SyntheticFrames synthetic;
+		std::vector<FrameSample> frames(23);
+		ControllerInput input;
+		input.basePixels = 2016.0f * 2240.0f;
+		run("controller/update", [&](uint64_t i)
+			{
+				for (FrameSample &frame : frames)
+					frame = synthetic.next();
+				input.timeMs = long(i) * config.dataPullDelayMs;
+				Decision decision = controller.update(input, frames.data(), uint32_t(frames.size()));
+				input.currentRes = decision.newRes;
+				sink = decision.newRes; });
+	}
+
+	// Laying out the window
+	{
+		UiSnapshot snapshot = busySnapshot();
+		UiScreen screen;
+		run("ui/format", [&](uint64_t)
+			{
+				formatUi(snapshot, "bench", screen);
+				sink = float(screen[0].text[0]); });
+	}
+
+	// Parsing and validating settings.ini
+	{
+		std::string text = fallbackSettings;
+		std::ifstream file(args::get(settingsPath));
+		if (file)
+		{
+			std::stringstream contents;
+			contents << file.rdbuf();
+			text = contents.str();
+		}
+		else
+		{
+			fmt::print(stderr, "Could not read {}, parsing built-in settings\n", args::get(settingsPath));
+		}
+
+		run("settings/parse", [&](uint64_t)
+			{
+				Settings settings;
+				std::string error;
+				bool ok = parseSettings(text, settings, &error) && validateSettings(settings, error);
+				sink = ok ? settings.controller.maxRes : 0.0f; });
+	}
+
+	// Machine-readable results, one entry per benchmark
+	std::string json = "{\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult &r = results[i];
+		json += fmt::format("    {{\"name\": \"{}\", \"iterations\": {}, \"nsPerOp\": {:.2f}, \"allocsPerOp\": {:.3f}, \"bytesPerOp\": {:.1f}}}{}\n",
+							r.name, r.iterations, r.nsPerOp, r.allocsPerOp, r.bytesPerOp, i + 1 < results.size() ? "," : "");
+	}
+	json += "  ]\n}\n";
+
+	if (output)
+	{
+		std::ofstream file(args::get(output));
+		if (!file)
+		{
+			fmt::print(stderr, "Could not write {}\n", args::get(output));
+			return 1;
+		}
+		file << json;
+	}
+	else
+	{
+		fmt::print("{}", json);
+	}
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include "model.hpp"
+
+#include <algorithm>
+
+// Minimum weight before the fit is used
+static constexpr double minWeight = 32.0;
+// Relative spread of pixel counts needed to fit the fixed cost separately
+static constexpr double minRelativeVariance = 1e-3;
+
+GpuCostModel::GpuCostModel(size_t memorySamples)
+{
+	setMemory(memorySamples);
+}
+
+void GpuCostModel::setMemory(size_t memorySamples)
+{
+	decay = 1.0 - 1.0 / std::max<size_t>(memorySamples, 2);
+}
+
+void GpuCostModel::add(double pixels, double gpuMs)
+{
+	if (pixels <= 0 || gpuMs <= 0)
+		return;
+
+	weight = weight * decay + 1.0;
+	sumX = sumX * decay + pixels;
+	sumY = sumY * decay + gpuMs;
+	sumXX = sumXX * decay + pixels * pixels;
+	sumXY = sumXY * decay + pixels * gpuMs;
+}
+
+void GpuCostModel::clear()
+{
+	weight = sumX = sumY = sumXX = sumXY = 0.0;
+}
+
+bool GpuCostModel::ready() const
+{
+	return weight >= minWeight;
+}
+
+void GpuCostModel::fit(double &fixed, double &perPixel) const
+{
+	fixed = 0.0;
+	perPixel = 0.0;
+	if (weight <= 0)
+		return;
+
+	double meanX = sumX / weight;
+	double meanY = sumY / weight;
+	double varianceX = sumXX / weight - meanX * meanX;
+	double covariance = sumXY / weight - meanX * meanY;
+
+	if (varianceX > meanX * meanX * minRelativeVariance)
+	{
+		perPixel = covariance / varianceX;
+		fixed = meanY - perPixel * meanX;
+	}
+
+	// Not enough spread, or a fit that makes no physical sense: everything scales with pixels
+	if (perPixel <= 0 || fixed < 0 || fixed > meanY)
+	{
+		fixed = 0.0;
+		perPixel = meanY / meanX;
+	}
+}
+
+double GpuCostModel::fixedMs() const
+{
+	double fixed, perPixel;
+	fit(fixed, perPixel);
+	return fixed;
+}
+
+double GpuCostModel::msPerPixel() const
+{
+	double fixed, perPixel;
+	fit(fixed, perPixel);
+	return perPixel;
+}
+
+double GpuCostModel::predictGpuMs(double pixels) const
+{
+	double fixed, perPixel;
+	fit(fixed, perPixel);
+	return fixed + perPixel * pixels;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+// Online linear fit of GPU frametime against rendered pixel count:
+//   gpuMs = fixedMs + msPerPixel * pixels
+// Samples are weighted with exponential forgetting so the fit follows the
+// scene. When the resolution hasn't moved enough to tell the fixed cost from
+// the per-pixel cost, all of the frametime is assumed to scale with pixels.
+class GpuCostModel
+{
+public:
+	// memorySamples: number of samples after which a sample's weight has decayed to ~37%
+	explicit GpuCostModel(size_t memorySamples);
+
+	// Changes how fast old samples are forgotten, keeping the current fit
+	void setMemory(size_t memorySamples);
+
+	void add(double pixels, double gpuMs);
+	void clear();
+
+	// Whether enough samples were seen to trust the fit
+	bool ready() const;
+
+	double fixedMs() const;
+	double msPerPixel() const;
+
+	double predictGpuMs(double pixels) const;
+
+private:
+	void fit(double &fixed, double &perPixel) const;
+
+	double decay;
+	double weight = 0.0;
+	double sumX = 0.0;
+	double sumY = 0.0;
+	double sumXX = 0.0;
+	double sumXY = 0.0;
+};
@@ -0,0 +1,92 @@
+#include "pipeline.hpp"
+
+#include "controller.hpp"
+
+const char *stageName(Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::AppCpu:
+		return "app-cpu";
+	case Stage::CompositorCpu:
+		return "compositor-cpu";
+	case Stage::Submit:
+		return "submit";
+	case Stage::WaitForPresent:
+		return "wait-for-present";
+	case Stage::PresentCall:
+		return "present-call";
+	case Stage::ClientFrameInterval:
+		return "client-frame-interval";
+	case Stage::PreSubmitGpu:
+		return "pre-submit-gpu";
+	case Stage::PostSubmitGpu:
+		return "post-submit-gpu";
+	case Stage::TotalGpu:
+		return "total-gpu";
+	case Stage::CompositorGpu:
+		return "compositor-gpu";
+	case Stage::CompositorIdle:
+		return "compositor-idle";
+	default:
+		return "unknown";
+	}
+}
+
+float stageMs(const FrameSample &frame, Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::AppCpu:
+		return frame.newFrameReadyMs - frame.newPosesReadyMs;
+	case Stage::CompositorCpu:
+		return frame.compositorRenderCpuMs;
+	case Stage::Submit:
+		return frame.submitFrameMs;
+	case Stage::WaitForPresent:
+		return frame.waitForPresentCpuMs;
+	case Stage::PresentCall:
+		return frame.presentCallCpuMs;
+	case Stage::ClientFrameInterval:
+		return frame.clientFrameIntervalMs;
+	case Stage::PreSubmitGpu:
+		return frame.preSubmitGpuMs;
+	case Stage::PostSubmitGpu:
+		return frame.postSubmitGpuMs;
+	case Stage::TotalGpu:
+		return frame.totalRenderGpuMs;
+	case Stage::CompositorGpu:
+		return frame.compositorRenderGpuMs;
+	case Stage::CompositorIdle:
+		return frame.compositorIdleCpuMs;
+	default:
+		return 0.0f;
+	}
+}
+
+PipelineStats::PipelineStats(size_t windowSamples, size_t averageSamples)
+	: stages(stageCount, FrametimeStats(windowSamples, averageSamples))
+{
+}
+
+void PipelineStats::push(const FrameSample &frame)
+{
+	for (size_t i = 0; i < stageCount; i++)
+		stages[i].push(stageMs(frame, Stage(i)));
+	dropped += frame.numDroppedFrames;
+	misPresented += frame.numMisPresented;
+}
+
+void PipelineStats::clear()
+{
+	for (FrametimeStats &stats : stages)
+		stats.clear();
+	dropped = 0;
+	misPresented = 0;
+}
+
+void PipelineStats::resize(size_t windowSamples, size_t averageSamples)
+{
+	for (FrametimeStats &stats : stages)
+		stats.resize(windowSamples, averageSamples);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "stats.hpp"
+
+struct FrameSample;
+
+// Stages of a frame that Compositor_FrameTiming reports, in milliseconds
+enum class Stage : uint8_t
+{
+	AppCpu,				 // Application CPU work, from new poses ready to new frame ready
+	CompositorCpu,		 // Compositor CPU work
+	Submit,				 // Submit calls of the application
+	WaitForPresent,		 // Compositor waiting for the present of the previous frame
+	PresentCall,		 // Compositor present call
+	ClientFrameInterval, // Time between two frames of the application
+	PreSubmitGpu,		 // Application GPU work before its first submit
+	PostSubmitGpu,		 // Application GPU work after its last submit
+	TotalGpu,			 // Application and compositor GPU work
+	CompositorGpu,		 // Compositor GPU work
+	CompositorIdle,		 // Compositor CPU idle time
+};
+
+static constexpr size_t stageCount = size_t(Stage::CompositorIdle) + 1;
+
+const char *stageName(Stage stage);
+
+// Value of a stage for one frame
+float stageMs(const FrameSample &frame, Stage stage);
+
+// Windows of every stage of the frames, plus the dropped and mispresented
+// frames since the last clear. Pushing a frame is O(stageCount).
+class PipelineStats
+{
+public:
+	PipelineStats(size_t windowSamples, size_t averageSamples);
+
+	void push(const FrameSample &frame);
+	void clear();
+	// Changes the window and averaging sizes, keeping the newest frames that still fit
+	void resize(size_t windowSamples, size_t averageSamples);
+
+	const FrametimeStats &stage(Stage stage) const { return stages[size_t(stage)]; }
+	uint64_t droppedFrames() const { return dropped; }
+	uint64_t misPresentedFrames() const { return misPresented; }
+
+private:
+	std::vector<FrametimeStats> stages;
+	uint64_t dropped = 0;
+	uint64_t misPresented = 0;
+};
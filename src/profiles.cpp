@@ -0,0 +1,109 @@
+#include <cmath>
+
+#include "SimpleIni.h"
+#include "profiles.hpp"
+
+// Smallest resolution difference worth rewriting the profile for
+static constexpr float resEpsilon = 0.005f;
+
+bool ProfileStore::load(const char *path)
+{
+	CSimpleIniA ini;
+	if (ini.LoadFile(path) < 0)
+		return false;
+
+	CSimpleIniA::TNamesDepend sections;
+	ini.GetAllSections(sections);
+	for (const CSimpleIniA::Entry &section : sections)
+	{
+		AppProfile profile;
+		profile.res = float(ini.GetDoubleValue(section.pItem, "res", 0.0) / 100.0);
+		profile.gpuTime = float(ini.GetDoubleValue(section.pItem, "gpuTime", 0.0));
+		profile.cpuTime = float(ini.GetDoubleValue(section.pItem, "cpuTime", 0.0));
+		profile.sessions = ini.GetLongValue(section.pItem, "sessions", 0);
+		profile.hitch.missedFrames = float(ini.GetDoubleValue(section.pItem, "hitchFrames", 0.0));
+		profile.hitch.spikeMs = float(ini.GetDoubleValue(section.pItem, "hitchSpikeMs", 0.0));
+		profile.hitch.recoveryMs = float(ini.GetDoubleValue(section.pItem, "hitchRecoveryMs", 0.0));
+		profile.hitch.samples = uint32_t(ini.GetLongValue(section.pItem, "hitchSamples", 0));
+		if (profile.res > 0)
+			profiles[section.pItem] = profile;
+	}
+	return true;
+}
+
+bool ProfileStore::save(const char *path) const
+{
+	CSimpleIniA ini;
+	for (const auto &[appKey, profile] : profiles)
+	{
+		ini.SetDoubleValue(appKey.c_str(), "res", std::round(profile.res * 1000.0) / 10.0);
+		ini.SetDoubleValue(appKey.c_str(), "gpuTime", profile.gpuTime);
+		ini.SetDoubleValue(appKey.c_str(), "cpuTime", profile.cpuTime);
+		ini.SetLongValue(appKey.c_str(), "sessions", profile.sessions);
+		if (profile.hitch.samples > 0)
+		{
+			ini.SetDoubleValue(appKey.c_str(), "hitchFrames", profile.hitch.missedFrames);
+			ini.SetDoubleValue(appKey.c_str(), "hitchSpikeMs", profile.hitch.spikeMs);
+			ini.SetDoubleValue(appKey.c_str(), "hitchRecoveryMs", profile.hitch.recoveryMs);
+			ini.SetLongValue(appKey.c_str(), "hitchSamples", long(profile.hitch.samples));
+		}
+	}
+	return ini.SaveFile(path) >= 0;
+}
+
+const AppProfile *ProfileStore::find(const std::string &appKey) const
+{
+	auto it = profiles.find(appKey);
+	return it != profiles.end() ? &it->second : nullptr;
+}
+
+void ProfileStore::update(const std::string &appKey, const AppProfile &profile)
+{
+	profiles[appKey] = profile;
+}
+
+const AppProfile *ProfileTracker::changeApp(const std::string &appKey, long timeMs)
+{
+	if (appKey == currentKey)
+		return nullptr;
+
+	currentKey = appKey;
+	newSession = true;
+	heldRes = 0.0f;
+	heldSince = timeMs;
+
+	const AppProfile *profile = appKey.empty() ? nullptr : store.find(appKey);
+	savedRes = profile ? profile->res : 0.0f;
+	return profile;
+}
+
+bool ProfileTracker::observe(long timeMs, float res, float gpuTime, float cpuTime, const HitchEstimate &hitch, bool dashboardVisible)
+{
+	if (currentKey.empty())
+		return false;
+
+	// Time spent in the dashboard says nothing about the game
+	if (dashboardVisible || res != heldRes)
+	{
+		heldRes = res;
+		heldSince = timeMs;
+		return false;
+	}
+	if (timeMs - heldSince < settleMs)
+		return false;
+	if (!newSession && std::fabs(res - savedRes) < resEpsilon)
+		return false;
+
+	const AppProfile *previous = store.find(currentKey);
+	AppProfile profile;
+	profile.res = res;
+	profile.gpuTime = gpuTime;
+	profile.cpuTime = cpuTime;
+	profile.hitch = hitch;
+	profile.sessions = (previous ? previous->sessions : 0) + (newSession ? 1 : 0);
+	store.update(currentKey, profile);
+
+	newSession = false;
+	savedRes = res;
+	return true;
+}
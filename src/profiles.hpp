@@ -0,0 +1,62 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "hitch.hpp"
+
+// What the controller settled on for one application
+struct AppProfile
+{
+	float res = 0.0f;
+	float gpuTime = 0.0f;
+	float cpuTime = 0.0f;
+	long sessions = 0;
+	// What its resolution changes cost
+	HitchEstimate hitch;
+};
+
+// Per-application profiles, one ini section per OpenVR application key
+class ProfileStore
+{
+public:
+	// Keeps the current profiles if the file can't be read
+	bool load(const char *path);
+	bool save(const char *path) const;
+
+	// Null if the application has no profile yet
+	const AppProfile *find(const std::string &appKey) const;
+	void update(const std::string &appKey, const AppProfile &profile);
+
+	size_t size() const { return profiles.size(); }
+
+private:
+	std::map<std::string, AppProfile> profiles;
+};
+
+// Follows the scene application and the resolution it settles on.
+// A resolution counts as settled once it was held for settleMs outside of the dashboard.
+class ProfileTracker
+{
+public:
+	ProfileTracker(ProfileStore &store, long settleMs) : store(store), settleMs(settleMs) {}
+
+	// Switches to another scene application (empty key = none).
+	// Returns the profile to warm start from, or null.
+	const AppProfile *changeApp(const std::string &appKey, long timeMs);
+
+	// Called every tick with the resolution in use. Returns true when the
+	// profile of the current application was updated and should be saved.
+	bool observe(long timeMs, float res, float gpuTime, float cpuTime, const HitchEstimate &hitch, bool dashboardVisible);
+
+	const std::string &appKey() const { return currentKey; }
+
+private:
+	ProfileStore &store;
+	long settleMs;
+	std::string currentKey;
+	bool newSession = false;
+	float heldRes = 0.0f;
+	long heldSince = 0;
+	float savedRes = 0.0f;
+};
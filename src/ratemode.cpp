@@ -0,0 +1,62 @@
+#include "ratemode.hpp"
+
+const char *rateModeName(RateMode mode)
+{
+	switch (mode)
+	{
+	case RateMode::Half:
+		return "half";
+	default:
+		return "native";
+	}
+}
+
+RateMode RateModeSelector::update(const RateModeInput &input)
+{
+	if (!started)
+	{
+		started = true;
+		since = input.timeMs;
+	}
+
+	// Settings forcing a mode don't wait
+	bool forced = input.alwaysReproject || input.ignoreCpuTime;
+	RateMode next = preferred(input);
+	if (next != current && (forced || input.timeMs - since >= input.minDwellMs))
+	{
+		current = next;
+		since = input.timeMs;
+		switchCount++;
+		lateCpuMs = current == RateMode::Half && input.preferReprojection && input.cpuBound ? input.cpuMs : 0.0f;
+	}
+	return current;
+}
+
+RateMode RateModeSelector::preferred(const RateModeInput &input) const
+{
+	if (input.alwaysReproject)
+		return RateMode::Half;
+	if (input.ignoreCpuTime)
+		return RateMode::Native;
+
+	// Leaving the current mode takes crossing the threshold by the margin
+	bool half = current == RateMode::Half;
+	float enter = 1.0f + input.hysteresis;
+	float leave = 1.0f - input.hysteresis;
+
+	// The CPU can't keep up with native rate
+	float cpuLimit = input.realTargetMs * (input.preferReprojection ? 1.0f : 2.0f);
+	if (input.cpuMs > cpuLimit * (half ? leave : enter))
+		return RateMode::Half;
+	// Frames late on the CPU. They aren't anymore at half rate, so leaving takes the
+	// CPU frametime dropping by the margin under what it was when they were.
+	if (input.preferReprojection && (half && lateCpuMs > 0 ? input.cpuMs > lateCpuMs * leave : input.cpuBound))
+		return RateMode::Half;
+
+	// The GPU can't sustain minRes at native rate, but could at half rate
+	if (input.preferReprojection && input.nativeRes > 0 && input.halfRes > 0 &&
+		input.nativeRes < input.minRes * (half ? enter : leave) && input.halfRes >= input.minRes)
+		return RateMode::Half;
+
+	return RateMode::Native;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+// Frame rate the GPU frametime target is set for
+enum class RateMode : uint8_t
+{
+	Native, // Every refresh of the HMD
+	Half,	// Every other refresh, the compositor reprojects the rest
+};
+
+const char *rateModeName(RateMode mode);
+
+// What the mode is chosen from, once per tick
+struct RateModeInput
+{
+	long timeMs = 0;
+	// Frametime of the HMD refresh rate
+	float realTargetMs = 0.0f;
+	// Average application CPU frametime, not adjusted for reprojection
+	float cpuMs = 0.0f;
+	// Most of the recent frames were late on the CPU
+	bool cpuBound = false;
+	// Resolution the GPU could sustain in each mode (0 = unknown)
+	float nativeRes = 0.0f;
+	float halfRes = 0.0f;
+	float minRes = 0.0f;
+
+	int alwaysReproject = 0;
+	int preferReprojection = 0;
+	int ignoreCpuTime = 0;
+	// Relative margin around each switching threshold
+	float hysteresis = 0.1f;
+	// Shortest time spent in a mode before switching again
+	long minDwellMs = 0;
+};
+
+// Picks between native and half rate. The thresholds to leave a mode are
+// further away than the ones to enter it, and a mode is kept for at least
+// minDwellMs, so that the target frametime doesn't flip back and forth (and
+// drag the resolution with it) when the CPU frametime sits on a boundary.
+// alwaysReproject and ignoreCpuTime force a mode right away.
+//
+// Half rate wins when the CPU can't keep up with native rate (over the
+// refresh interval with preferReprojection, or over twice of it without, or
+// most frames late on the CPU with preferReprojection), or, with
+// preferReprojection, when the GPU couldn't even sustain minRes at native
+// rate while it could at half rate.
+class RateModeSelector
+{
+public:
+	// Returns the mode to use from now on
+	RateMode update(const RateModeInput &input);
+
+	RateMode mode() const { return current; }
+	// When the current mode was entered
+	long enteredMs() const { return since; }
+	uint64_t switches() const { return switchCount; }
+
+private:
+	RateMode preferred(const RateModeInput &input) const;
+
+	RateMode current = RateMode::Native;
+	// CPU frametime when half rate was entered for frames late on the CPU (0 otherwise)
+	float lateCpuMs = 0.0f;
+	bool started = false;
+	long since = 0;
+	uint64_t switchCount = 0;
+};
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <fmt/core.h>
+#include <args.hxx>
+
+#include "controller.hpp"
+#include "settings.hpp"
+#include "trace.hpp"
+#include "tracecsv.hpp"
+
+// Synthetic workload: GPU time scales with the rendered pixel count (i.e. the
+// supersample scale), with noise and a scene change every sceneLengthS seconds.
+static std::vector<TraceFrame> makeSyntheticTrace(float hz, float gpuMs, float cpuMs, float noise, double durationS, double sceneLengthS, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::normal_distribution<float> jitter(0.0f, noise);
+	std::uniform_real_distribution<float> sceneLoad(0.6f, 1.6f);
+
+	std::vector<TraceFrame> frames;
+	size_t count = size_t(durationS * hz);
+	frames.reserve(count);
+
+	float load = 1.0f;
+	double frametimeMs = 1000.0 / hz;
+	for (size_t i = 0; i < count; i++)
+	{
+		double timeMs = i * frametimeMs;
+		if (i > 0 && size_t(timeMs / (sceneLengthS * 1000.0)) != size_t((timeMs - frametimeMs) / (sceneLengthS * 1000.0)))
+			load = sceneLoad(rng);
+
+		TraceFrame trace;
+		trace.timeMs = timeMs;
+		trace.res = 1.0f;
+		trace.frame.frameIndex = uint32_t(i);
+		trace.frame.totalRenderGpuMs = std::max(0.1f, gpuMs * load * (1.0f + jitter(rng)));
+		trace.frame.newFrameReadyMs = std::max(0.1f, cpuMs * (1.0f + jitter(rng)));
+		frames.push_back(trace);
+	}
+	return frames;
+}
+
+int main(int argc, char *argv[])
+{
+	args::ArgumentParser parser("Replays a frame-timing trace through the resolution controller, without a headset.",
+								"Prints one CSV row per controller tick and a summary on stderr.");
+	args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
+	args::ValueFlag<std::string> settingsPath(parser, "file", "Settings file to load", {'s', "settings"}, "settings.ini");
+	args::ValueFlag<std::string> tracePath(parser, "file", "Binary or CSV trace to replay (see tracecsv.hpp for the CSV columns)", {'t', "trace"});
+	args::Flag synthetic(parser, "synthetic", "Generate a synthetic trace instead", {"synthetic"});
+	args::ValueFlag<float> hz(parser, "hz", "HMD refresh rate", {"hz"}, 90.0f);
+	args::ValueFlag<float> gpuMs(parser, "ms", "Synthetic GPU frametime at 100% resolution", {"gpu-ms"}, 8.0f);
+	args::ValueFlag<float> cpuMs(parser, "ms", "Synthetic CPU frametime", {"cpu-ms"}, 5.0f);
+	args::ValueFlag<float> noise(parser, "fraction", "Synthetic frametime noise (standard deviation)", {"noise"}, 0.05f);
+	args::ValueFlag<double> duration(parser, "seconds", "Synthetic trace length", {"duration"}, 600.0);
+	args::ValueFlag<double> sceneLength(parser, "seconds", "Time between synthetic scene changes", {"scene-length"}, 30.0);
+	args::ValueFlag<unsigned> seed(parser, "seed", "Synthetic trace random seed", {"seed"}, 1);
+	args::ValueFlag<std::string> outputPath(parser, "file", "Write the per-tick CSV here instead of stdout", {'o', "output"});
+
+	try
+	{
+		parser.ParseCLI(argc, argv);
+	}
+	catch (const args::Help &)
+	{
+		std::cout << parser;
+		return 0;
+	}
+	catch (const args::Error &e)
+	{
+		std::cerr << e.what() << std::endl
+				  << parser;
+		return 1;
+	}
+
+	Settings settings;
+	if (!loadSettings(args::get(settingsPath).c_str(), settings))
+		fmt::print(stderr, "Could not load {}, using defaults\n", args::get(settingsPath));
+	const ControllerConfig &config = settings.controller;
+
+	std::vector<TraceFrame> trace;
+	if (synthetic)
+	{
+		trace = makeSyntheticTrace(args::get(hz), args::get(gpuMs), args::get(cpuMs), args::get(noise),
+								   args::get(duration), args::get(sceneLength), args::get(seed));
+	}
+	else if (tracePath)
+	{
+		std::string error;
+		std::vector<TraceTick> ticks;
+		bool read = isBinaryTrace(args::get(tracePath)) ? readTrace(args::get(tracePath), trace, ticks, error)
+														: readCsvTrace(args::get(tracePath), trace, error);
+		if (!read)
+		{
+			fmt::print(stderr, "{}\n", error);
+			return 1;
+		}
+	}
+	else
+	{
+		std::cerr << "Either --trace or --synthetic is required" << std::endl
+				  << parser;
+		return 1;
+	}
+	if (trace.empty())
+	{
+		fmt::print(stderr, "Trace is empty\n");
+		return 1;
+	}
+
+	FILE *output = stdout;
+	if (outputPath)
+	{
+		output = fopen(args::get(outputPath).c_str(), "w");
+		if (!output)
+		{
+			fmt::print(stderr, "Could not open {}\n", args::get(outputPath));
+			return 1;
+		}
+	}
+
+	auto wallStart = std::chrono::steady_clock::now();
+
+	ResolutionController controller(config);
+	ControllerInput input;
+	input.displayHz = args::get(hz);
+	input.currentRes = config.initialRes;
+
+	fmt::print(output, "timeMs,res,averageGpuTime,averageCpuTime,targetFrametime,action\n");
+
+	std::vector<FrameSample> batch;
+	batch.reserve(trace.size());
+	double frametimeMs = 1000.0 / input.displayHz;
+	double timeMs = 0.0;
+	double nextTickMs = 0.0;
+	size_t ticks = 0;
+	size_t changes = 0;
+	size_t framesOverTarget = 0;
+	double resSum = 0.0;
+
+	for (const TraceFrame &traced : trace)
+	{
+		if (traced.timeMs >= 0)
+			timeMs = traced.timeMs;
+		else
+			timeMs += frametimeMs * std::max(traced.frame.numFramePresents, 1u);
+
+		// Recorded GPU time follows the resolution we would have set
+		FrameSample frame = traced.frame;
+		if (traced.res > 0)
+			frame.totalRenderGpuMs *= input.currentRes / traced.res;
+		if (frame.totalRenderGpuMs > frametimeMs)
+			framesOverTarget++;
+		resSum += input.currentRes;
+		batch.push_back(frame);
+
+		if (timeMs < nextTickMs)
+			continue;
+
+		input.timeMs = long(timeMs);
+		Decision decision = controller.update(input, batch.data(), uint32_t(batch.size()));
+		batch.clear();
+		ticks++;
+		if (decision.changed)
+		{
+			input.currentRes = decision.newRes;
+			changes++;
+		}
+
+		fmt::print(output, "{:.0f},{:.3f},{:.3f},{:.3f},{:.3f},{}\n", timeMs, input.currentRes, controller.averageGpuTime(),
+				   controller.averageCpuTime(), controller.targetFrametime(), actionName(decision.action));
+
+		nextTickMs = timeMs + controller.nextPollDelay(input.timeMs);
+	}
+
+	if (output != stdout)
+		fclose(output);
+
+	double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+	fmt::print(stderr, "Frames: {}\nTicks: {}\nResolution changes: {}\nAverage resolution: {:.1f}%\nFrames over HMD frametime: {:.2f}%\n",
+			   trace.size(), ticks, changes, resSum / trace.size() * 100.0, framesOverTarget * 100.0 / trace.size());
+	fmt::print(stderr, "Replayed {:.1f}s of frames in {:.1f}ms ({:.0f}x real time)\n",
+			   timeMs / 1000.0, wallMs, timeMs / std::max(wallMs, 0.001));
+
+	return 0;
+}
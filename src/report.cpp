@@ -0,0 +1,162 @@
+#include "report.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iterator>
+#include <fmt/format.h>
+
+#include "controller.hpp"
+
+void FrametimeHistogram::add(float ms)
+{
+	size_t bin = ms > 0.0f ? std::min(size_t(ms / binWidthMs), binCount - 1) : 0;
+	bins[bin]++;
+	total++;
+	sum += ms;
+}
+
+float FrametimeHistogram::percentile(float p) const
+{
+	if (total == 0)
+		return 0.0f;
+
+	// Same as FrametimeStats: find the bin holding the wanted rank, then interpolate within it
+	double rank = std::clamp(p, 0.0f, 100.0f) / 100.0 * total;
+	uint64_t seen = 0;
+	for (size_t bin = 0; bin < binCount; bin++)
+	{
+		if (bins[bin] == 0)
+			continue;
+		if (seen + bins[bin] >= rank)
+			return float((bin + (rank - seen) / bins[bin]) * binWidthMs);
+		seen += bins[bin];
+	}
+	return binCount * binWidthMs;
+}
+
+void SessionReport::addTime(long timeMs, SessionState state, float res)
+{
+	long elapsed = started ? std::max(timeMs - lastMs, 0L) : 0;
+	started = true;
+	lastMs = timeMs;
+
+	stateTime[size_t(state)] += elapsed;
+	if (state != SessionState::InApp)
+		return;
+	resTime[std::min(size_t(std::max(res, 0.0f) / resBucket + 0.5f), resBuckets - 1)] += elapsed;
+	resTimeSum += double(res) * elapsed;
+}
+
+void SessionReport::addFrame(float gpuMs, float cpuMs, uint32_t presents, uint32_t droppedFrames)
+{
+	gpu.add(gpuMs);
+	cpu.add(cpuMs);
+	if (presents > 1)
+		reprojected++;
+	dropped += droppedFrames;
+}
+
+void SessionReport::addChange(float fromRes, float toRes)
+{
+	if (toRes > fromRes)
+		ups++;
+	else
+		downs++;
+	changes[std::min(size_t(std::lround(std::fabs(toRes - fromRes) * 100)), changeBins - 1)]++;
+}
+
+void SessionReport::addVram(float usage)
+{
+	vram = std::max(vram, usage);
+}
+
+float SessionReport::averageRes() const
+{
+	long inApp = stateTime[size_t(SessionState::InApp)];
+	return inApp > 0 ? float(resTimeSum / inApp) : 0.0f;
+}
+
+// UTC, e.g. 2024-05-01T18:30:00Z
+static std::string isoTime(long ms)
+{
+	std::time_t seconds = ms / 1000;
+	char text[32] = "";
+	if (const std::tm *utc = std::gmtime(&seconds))
+		std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", utc);
+	return text;
+}
+
+template <typename It>
+static void appendFrametimes(It it, const char *name, const FrametimeHistogram &h)
+{
+	fmt::format_to(it, ", \"{}\": {{\"average\": {:.2f}, \"p50\": {:.2f}, \"p95\": {:.2f}, \"p99\": {:.2f}, \"histogram\": {{",
+				   name, h.average(), h.percentile(50), h.percentile(95), h.percentile(99));
+	// Only the bins that got frames, keyed by their lower bound
+	bool first = true;
+	for (size_t i = 0; i < FrametimeHistogram::binCount; i++)
+	{
+		if (h.bin(i) == 0)
+			continue;
+		fmt::format_to(it, "{}\"{:.1f}\": {}", first ? "" : ", ", i * FrametimeHistogram::binWidthMs, h.bin(i));
+		first = false;
+	}
+	fmt::format_to(it, "}}}}");
+}
+
+bool appendReport(const std::string &path, const ReportHeader &header, const ControllerConfig &config, const SessionReport &report)
+{
+	std::string json;
+	auto it = std::back_inserter(json);
+
+	fmt::format_to(it, "{{\"version\": \"{}\", \"runtime\": \"{}\", \"start\": \"{}\", \"durationSeconds\": {:.1f}",
+				   header.version, header.runtime, isoTime(header.startMs), (header.endMs - header.startMs) / 1000.0);
+	// What usually differs between settings files
+	fmt::format_to(it, ", \"settings\": {{\"minRes\": {}, \"maxRes\": {}, \"initialRes\": {}, \"resIncreaseThreshold\": {}, "
+					   "\"resDecreaseThreshold\": {}, \"resChangeDelayMs\": {}, \"dataAverageSamples\": {}, \"controllerMode\": {}, "
+					   "\"alwaysReproject\": {}, \"preferReprojection\": {}, \"vramTarget\": {}}}",
+				   config.minRes, config.maxRes, config.initialRes, config.resIncreaseThreshold,
+				   config.resDecreaseThreshold, config.resChangeDelayMs, config.dataAverageSamples, config.controllerMode,
+				   config.alwaysReproject, config.preferReprojection, config.vramTarget);
+
+	fmt::format_to(it, ", \"stateSeconds\": {{");
+	for (size_t i = 0; i < sessionStateCount; i++)
+		fmt::format_to(it, "{}\"{}\": {:.1f}", i > 0 ? ", " : "", sessionStateName(SessionState(i)), report.stateMs(SessionState(i)) / 1000.0);
+	fmt::format_to(it, "}}");
+
+	// Time in the application at each resolution, keyed by the percentage the bucket is centered on
+	fmt::format_to(it, ", \"averageRes\": {:.3f}, \"resolutionSeconds\": {{", report.averageRes());
+	bool first = true;
+	for (size_t i = 0; i < SessionReport::resBuckets; i++)
+	{
+		if (report.resMs(i) == 0)
+			continue;
+		fmt::format_to(it, "{}\"{}\": {:.1f}", first ? "" : ", ", std::lround(i * SessionReport::resBucket * 100), report.resMs(i) / 1000.0);
+		first = false;
+	}
+	fmt::format_to(it, "}}");
+
+	uint64_t frames = report.frames();
+	fmt::format_to(it, ", \"frames\": {}, \"reprojectedFrames\": {}, \"reprojectionRatio\": {:.4f}, \"droppedFrames\": {}",
+				   frames, report.reprojectedFrames(), frames > 0 ? double(report.reprojectedFrames()) / frames : 0.0, report.droppedFrames());
+	appendFrametimes(it, "gpuMs", report.gpuTimes());
+	appendFrametimes(it, "cpuMs", report.cpuTimes());
+
+	fmt::format_to(it, ", \"changes\": {{\"increases\": {}, \"decreases\": {}, \"sizePercent\": {{", report.increases(), report.decreases());
+	first = true;
+	for (size_t i = 0; i < SessionReport::changeBins; i++)
+	{
+		if (report.changeSizes(i) == 0)
+			continue;
+		fmt::format_to(it, "{}\"{}\": {}", first ? "" : ", ", i, report.changeSizes(i));
+		first = false;
+	}
+	fmt::format_to(it, "}}}}, \"vramPeak\": {:.3f}}}\n", report.vramPeak());
+
+	FILE *file = fopen(path.c_str(), "ab");
+	if (!file)
+		return false;
+	bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+	return fclose(file) == 0 && written;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "session.hpp"
+
+struct ControllerConfig;
+
+// Frametimes of a whole session. Fixed size, adding a frame never allocates.
+class FrametimeHistogram
+{
+public:
+	// Anything slower lands in the last bin
+	static constexpr float binWidthMs = 0.5f;
+	static constexpr size_t binCount = 100;
+
+	void add(float ms);
+
+	uint64_t count() const { return total; }
+	uint64_t bin(size_t i) const { return bins[i]; }
+	// Mean of every frame (0 if none)
+	float average() const { return total > 0 ? float(sum / total) : 0.0f; }
+	// Percentile (0-100), interpolated within its bin (0 if none)
+	float percentile(float p) const;
+
+private:
+	std::array<uint64_t, binCount> bins{};
+	uint64_t total = 0;
+	double sum = 0.0;
+};
+
+// What a session looked like from start to end, to compare settings across real
+// sessions: time spent at each resolution, frametimes and reprojection of the
+// application's frames, resolution changes and the VRAM peak.
+class SessionReport
+{
+public:
+	// Resolution buckets, anything above lands in the last one
+	static constexpr float resBucket = 0.05f;
+	static constexpr size_t resBuckets = 101;
+	// Sizes of the resolution changes in whole percents, anything larger lands in the last one
+	static constexpr size_t changeBins = 26;
+
+	// Time since the previous call is spent in state, at res
+	void addTime(long timeMs, SessionState state, float res);
+	// One frame of the application
+	void addFrame(float gpuMs, float cpuMs, uint32_t presents, uint32_t dropped);
+	void addChange(float fromRes, float toRes);
+	void addVram(float usage);
+
+	// Time in each state, and in the application at each resolution bucket
+	long stateMs(SessionState state) const { return stateTime[size_t(state)]; }
+	long resMs(size_t bucket) const { return resTime[bucket]; }
+	// Mean resolution over the time in the application (0 if none)
+	float averageRes() const;
+
+	const FrametimeHistogram &gpuTimes() const { return gpu; }
+	const FrametimeHistogram &cpuTimes() const { return cpu; }
+	uint64_t frames() const { return gpu.count(); }
+	// Frames shown more than once
+	uint64_t reprojectedFrames() const { return reprojected; }
+	uint64_t droppedFrames() const { return dropped; }
+
+	uint64_t increases() const { return ups; }
+	uint64_t decreases() const { return downs; }
+	uint64_t changeSizes(size_t percent) const { return changes[percent]; }
+	float vramPeak() const { return vram; }
+
+private:
+	bool started = false;
+	long lastMs = 0;
+	std::array<long, sessionStateCount> stateTime{};
+	std::array<long, resBuckets> resTime{};
+	double resTimeSum = 0.0;
+
+	FrametimeHistogram gpu;
+	FrametimeHistogram cpu;
+	uint64_t reprojected = 0;
+	uint64_t dropped = 0;
+
+	uint64_t ups = 0;
+	uint64_t downs = 0;
+	std::array<uint64_t, changeBins> changes{};
+	float vram = 0.0f;
+};
+
+// Where the session ran, for telling reports apart
+struct ReportHeader
+{
+	const char *version = "";
+	// Milliseconds since the epoch
+	long startMs = 0;
+	long endMs = 0;
+	// "SteamVR" or the simulated scenario
+	std::string runtime;
+};
+
+// Appends the report as one line of JSON, so that a file collects every session
+bool appendReport(const std::string &path, const ReportHeader &header, const ControllerConfig &config, const SessionReport &report);
@@ -0,0 +1,117 @@
+#include "reprojection.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+
+ReprojectionInfo decodeReprojection(uint32_t flags)
+{
+	ReprojectionInfo info;
+	info.cpuLimited = flags & reprojectionReasonCpu;
+	info.gpuLimited = flags & reprojectionReasonGpu;
+	info.async = flags & reprojectionAsync;
+	info.motionSmoothed = flags & reprojectionMotion;
+	info.predictedFrames = (flags & reprojectionPredictionMask) >> 4;
+	info.throttledFrames = (flags & reprojectionThrottleMask) >> 8;
+	return info;
+}
+
+void describeReprojection(const ReprojectionInfo &info, char *text, size_t size)
+{
+	if (size == 0)
+		return;
+	size_t used = 0;
+	auto append = [&](const char *part)
+	{
+		auto result = fmt::format_to_n(text + used, size - 1 - used, "{}{}", used > 0 ? ", " : "", part);
+		used = std::min(size - 1, used + result.size);
+	};
+
+	bool cpuLate = info.cpuLate();
+	if (cpuLate && info.gpuLimited)
+		append("CPU+GPU");
+	else if (cpuLate)
+		append("CPU");
+	else if (info.gpuLimited)
+		append("GPU");
+	if (info.motionSmoothed)
+		append("motion smoothing");
+	if (info.throttledFrames > 0)
+	{
+		char throttle[16];
+		auto result = fmt::format_to_n(throttle, sizeof(throttle) - 1, "throttled {}", info.throttledFrames);
+		throttle[result.size] = '\0';
+		append(throttle);
+	}
+	if (info.predictedFrames > 0)
+	{
+		char predicted[16];
+		auto result = fmt::format_to_n(predicted, sizeof(predicted) - 1, "predicted {}", info.predictedFrames);
+		predicted[result.size] = '\0';
+		append(predicted);
+	}
+	if (used == 0)
+		append("Other");
+	text[used] = '\0';
+}
+
+ReprojectionStats::ReprojectionStats(size_t windowSamples)
+	: classes(std::max<size_t>(windowSamples, 1))
+{
+}
+
+void ReprojectionStats::push(uint32_t flags)
+{
+	ReprojectionInfo info = decodeReprojection(flags);
+	uint8_t bits = (info.cpuLate() ? 1 << cpuBit : 0) |
+				   (info.gpuLimited ? 1 << gpuBit : 0) |
+				   (info.throttledFrames > 0 ? 1 << throttleBit : 0) |
+				   (info.motionSmoothed ? 1 << motionBit : 0);
+
+	// Evict the oldest frame once the window is full
+	if (count == classes.size())
+	{
+		for (int i = 0; i < bitCount; i++)
+			counts[i] -= (classes[head] >> i) & 1;
+	}
+	else
+	{
+		count++;
+	}
+
+	classes[head] = bits;
+	for (int i = 0; i < bitCount; i++)
+		counts[i] += (bits >> i) & 1;
+	head = (head + 1) % classes.size();
+}
+
+void ReprojectionStats::clear()
+{
+	std::fill(std::begin(counts), std::end(counts), 0);
+	head = 0;
+	count = 0;
+}
+
+void ReprojectionStats::resize(size_t windowSamples)
+{
+	windowSamples = std::max<size_t>(windowSamples, 1);
+	if (windowSamples == classes.size())
+		return;
+
+	// Replay the newest frames, oldest first
+	std::vector<uint8_t> old = std::move(classes);
+	size_t oldHead = head;
+	size_t oldCount = count;
+	classes.assign(windowSamples, 0);
+	clear();
+
+	size_t keep = std::min(oldCount, windowSamples);
+	for (size_t i = keep; i > 0; i--)
+	{
+		uint8_t bits = old[(oldHead + old.size() - i) % old.size()];
+		classes[head] = bits;
+		for (int b = 0; b < bitCount; b++)
+			counts[b] += (bits >> b) & 1;
+		head = (head + 1) % classes.size();
+		count++;
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bits of Compositor_FrameTiming::m_nReprojectionFlags, mirroring
+// VRCompositor_ReprojectionReason_* and friends without depending on OpenVR
+// (vrruntime.cpp checks they still match)
+static constexpr uint32_t reprojectionReasonCpu = 0x01;
+static constexpr uint32_t reprojectionReasonGpu = 0x02;
+static constexpr uint32_t reprojectionAsync = 0x04;
+static constexpr uint32_t reprojectionMotion = 0x08;
+static constexpr uint32_t reprojectionPredictionMask = 0xF0;
+static constexpr uint32_t reprojectionThrottleMask = 0xF00;
+
+// What the compositor says about one frame
+struct ReprojectionInfo
+{
+	// Reprojected because the application's CPU or GPU work was late
+	bool cpuLimited = false;
+	bool gpuLimited = false;
+	// Asynchronous reprojection is active
+	bool async = false;
+	// Motion smoothing synthesized the frame
+	bool motionSmoothed = false;
+	// Frames the runtime predicts ahead beyond the usual one
+	uint32_t predictedFrames = 0;
+	// Frames the compositor is throttling the application by
+	uint32_t throttledFrames = 0;
+
+	// The compositor sets no reason when it predicts further ahead because the application's
+	// CPU work keeps missing (flags 20, async and 1 predicted frame, used to be shown as CPU),
+	// unless it's also throttling, which it does for GPU-late frames
+	bool cpuLate() const { return cpuLimited || (predictedFrames > 0 && !gpuLimited && throttledFrames == 0); }
+};
+
+ReprojectionInfo decodeReprojection(uint32_t flags);
+
+// Short description for the window, e.g. "CPU, predicted 1"
+void describeReprojection(const ReprojectionInfo &info, char *text, size_t size);
+
+// Counts of CPU-limited, GPU-limited, throttled and motion-smoothed frames
+// over a window of the newest frames. Pushing a frame is O(1).
+class ReprojectionStats
+{
+public:
+	explicit ReprojectionStats(size_t windowSamples);
+
+	void push(uint32_t flags);
+	void clear();
+	// Changes the window size, keeping the newest frames that still fit
+	void resize(size_t windowSamples);
+
+	size_t size() const { return count; }
+
+	uint32_t cpuLimited() const { return counts[cpuBit]; }
+	uint32_t gpuLimited() const { return counts[gpuBit]; }
+	uint32_t throttled() const { return counts[throttleBit]; }
+	uint32_t motionSmoothed() const { return counts[motionBit]; }
+
+	// Share of the window (0-1)
+	float cpuLimitedShare() const { return share(cpuLimited()); }
+	float gpuLimitedShare() const { return share(gpuLimited()); }
+	float throttledShare() const { return share(throttled()); }
+	float motionSmoothedShare() const { return share(motionSmoothed()); }
+
+private:
+	enum Bit : uint8_t
+	{
+		cpuBit,
+		gpuBit,
+		throttleBit,
+		motionBit,
+		bitCount,
+	};
+
+	float share(uint32_t n) const { return count > 0 ? float(n) / count : 0.0f; }
+
+	// One byte per frame, a bit per class
+	std::vector<uint8_t> classes;
+	uint32_t counts[bitCount] = {};
+	size_t head = 0; // next slot to write
+	size_t count = 0;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include "controller.hpp"
+#include "latency.hpp"
+
+// The parts of the VR runtime the main loop talks to.
+// OpenVrRuntime forwards to the real compositor; SimRuntime stands in for it
+// so the whole loop can run without SteamVR or a headset.
+class Runtime
+{
+public:
+	virtual ~Runtime() = default;
+
+	// Catches up with the runtime's events, called once per tick before the other calls
+	virtual void pollEvents() {}
+	// Latency of the calls made to the runtime (null if they aren't measured)
+	virtual const IpcStats *ipcStats() const { return nullptr; }
+	// Resolution writes superseded by a later one before they were sent
+	virtual uint64_t coalescedWrites() const { return 0; }
+	// The runtime is shutting down and asked its applications to exit
+	virtual bool quitRequested() const { return false; }
+
+	// Same contract as IVRCompositor::GetFrameTiming(timing, 0): the most recent frame
+	virtual bool getFrameTiming(FrameSample &frame) = 0;
+	// Same contract as IVRCompositor::GetFrameTimings: up to count most recent frames, oldest first
+	virtual uint32_t getFrameTimings(FrameSample *frames, uint32_t count) = 0;
+
+	// k_pch_SteamVR_SupersampleScale_Float
+	virtual float getSupersampleScale() = 0;
+	virtual void setSupersampleScale(float res) = 0;
+
+	// Per-eye render target size, with the current supersample scale applied
+	virtual void getRecommendedRenderTargetSize(uint32_t &width, uint32_t &height) = 0;
+
+	// Prop_DisplayFrequency_Float of the HMD
+	virtual float getDisplayFrequency() = 0;
+	virtual bool isDashboardVisible() = 0;
+	// Process rendering the current scene (0 if none)
+	virtual uint32_t getSceneProcessId() = 0;
+	// Application key (e.g. steam.app.620980) of a process, false if it isn't a known application
+	virtual bool getApplicationKey(uint32_t pid, char *key, uint32_t size) = 0;
+};
+
+// Pixels per eye at 100% resolution, from the recommended render target size
+inline float basePixelsFor(Runtime &runtime, float currentRes)
+{
+	uint32_t width = 0, height = 0;
+	runtime.getRecommendedRenderTargetSize(width, height);
+	if (currentRes <= 0)
+		return 0.0f;
+	return float(width) * float(height) / currentRes;
+}
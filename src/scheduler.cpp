@@ -0,0 +1,98 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ingest.hpp"
+
+// Distance from the decrease threshold, relative to the target frametime, needed to count as stable
+static constexpr float stableMargin = 0.05f;
+// GPU frametime spread (p95 - p50), relative to the target frametime, above which timings are volatile
+static constexpr float volatileSpread = 0.1f;
+// Share of the frame ingest buffer allowed to fill up between two ticks
+static constexpr float ingestFill = 0.75f;
+
+const char *pollStateName(PollState state)
+{
+	switch (state)
+	{
+	case PollState::Stable:
+		return "stable";
+	case PollState::Idle:
+		return "idle";
+	default:
+		return "active";
+	}
+}
+
+bool PollScheduler::isStable(const ResolutionController &controller, float currentRes) const
+{
+	float target = controller.targetFrametime();
+	float realTarget = controller.realTargetFrametime();
+	const FrametimeStats &gpuTimes = controller.gpuStats();
+	if (target <= 0 || gpuTimes.size() < gpuTimes.capacity() / 2)
+		return false;
+
+	// Nothing to adjust during loading screens and application switches
+	if (controller.sessionState() != SessionState::InApp && !cfg.vramOnlyMode)
+		return true;
+
+	// About to change, unless the resolution can't move that way anyway.
+	// Right above the increase threshold is where the controller settles, so only
+	// getting close to the decrease threshold counts.
+	float gpuTime = controller.averageGpuTime();
+	if (gpuTime < target * cfg.resIncreaseThreshold && currentRes < cfg.maxRes)
+		return false;
+	if (gpuTime > target * (cfg.resDecreaseThreshold - stableMargin) && currentRes > cfg.minRes)
+		return false;
+
+	// Volatile frametimes
+	if (gpuTimes.percentile(95) - gpuTimes.percentile(50) > target * volatileSpread)
+		return false;
+
+	// Close to where the CPU frametime makes the target double or come back
+	if (!cfg.ignoreCpuTime && !cfg.alwaysReproject)
+	{
+		float boundary = cfg.preferReprojection ? realTarget : realTarget * 2;
+		if (std::fabs(controller.averageCpuTime() - boundary) < realTarget * stableMargin * 2)
+			return false;
+	}
+
+	return true;
+}
+
+long PollScheduler::next(const ResolutionController &controller, long timeMs, float currentRes, float displayHz, bool dashboardVisible, bool sceneApp)
+{
+	long active = controller.nextPollDelay(timeMs);
+	if (!cfg.adaptivePolling)
+	{
+		current = PollState::Active;
+		lastDelay = active;
+		return lastDelay;
+	}
+
+	// Longest sleep before frames start falling out of the ingest buffer
+	long maxDelay = displayHz > 0 ? long(FrameIngest::capacity * ingestFill * 1000.0f / displayHz) : active;
+
+	// The frames of the dashboard or of the game starting up still have to be kept up with
+	if (dashboardVisible || !sceneApp)
+	{
+		current = PollState::Idle;
+		lastDelay = std::max(active, std::min(cfg.idlePollDelayMs, maxDelay));
+		return lastDelay;
+	}
+
+	if (isStable(controller, currentRes))
+	{
+		// Double the delay on every consecutive stable tick
+		long delay = current == PollState::Stable ? std::max(active, lastDelay * 2) : active;
+		current = PollState::Stable;
+		lastDelay = std::min(delay, maxDelay);
+	}
+	else
+	{
+		current = PollState::Active;
+		lastDelay = std::min(active, maxDelay);
+	}
+	return lastDelay;
+}
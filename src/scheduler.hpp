@@ -0,0 +1,40 @@
+#pragma once
+
+#include "controller.hpp"
+
+enum class PollState
+{
+	// Frametimes are volatile or close to a threshold: poll at the controller's pace, no faster.
+	// Every frame is read whatever the delay, and resChangeDelayMs gates the decisions anyway.
+	Active,
+	// Frametimes are well inside the thresholds: back off
+	Stable,
+	// Dashboard open or no game running: nothing to react to
+	Idle,
+};
+
+const char *pollStateName(PollState state);
+
+// Picks how long the main loop sleeps between two ticks. Never sleeps long
+// enough for the frame ingest buffer to overflow.
+class PollScheduler
+{
+public:
+	explicit PollScheduler(const ControllerConfig &config) : cfg(config) {}
+	void setConfig(const ControllerConfig &config) { cfg = config; }
+
+	// Delay before the next tick, given the controller state after this one
+	long next(const ResolutionController &controller, long timeMs, float currentRes, float displayHz, bool dashboardVisible, bool sceneApp);
+
+	PollState state() const { return current; }
+	long delay() const { return lastDelay; }
+	// Wakeups per second at the current delay
+	float pollRate() const { return lastDelay > 0 ? 1000.0f / lastDelay : 0.0f; }
+
+private:
+	bool isStable(const ResolutionController &controller, float currentRes) const;
+
+	ControllerConfig cfg;
+	PollState current = PollState::Active;
+	long lastDelay = 0;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer, multiple-reader snapshot of a trivially copyable value.
+// The writer never waits; readers retry if they raced with a write.
+// The value is kept in atomic words so that a torn read is well defined, just discarded.
+template <typename T>
+class Seqlock
+{
+	static_assert(std::is_trivially_copyable_v<T>, "Seqlock values are copied word by word");
+	static constexpr size_t wordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+	void store(const T &value)
+	{
+		uint64_t words[wordCount] = {};
+		std::memcpy(words, &value, sizeof(T));
+
+		uint64_t seq = sequence.load(std::memory_order_relaxed);
+		sequence.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i = 0; i < wordCount; i++)
+			data[i].store(words[i], std::memory_order_relaxed);
+		sequence.store(seq + 2, std::memory_order_release);
+	}
+
+	// Returns false while nothing was stored yet
+	bool load(T &value) const
+	{
+		uint64_t words[wordCount];
+		uint64_t before, after;
+		do
+		{
+			before = sequence.load(std::memory_order_acquire);
+			for (size_t i = 0; i < wordCount; i++)
+				words[i] = data[i].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = sequence.load(std::memory_order_relaxed);
+		} while ((before & 1) || before != after);
+
+		std::memcpy(&value, words, sizeof(T));
+		return before != 0;
+	}
+
+	// Changes every time a value is stored
+	uint64_t version() const { return sequence.load(std::memory_order_acquire); }
+
+private:
+	std::atomic<uint64_t> sequence{0};
+	std::atomic<uint64_t> data[wordCount] = {};
+};
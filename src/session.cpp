@@ -0,0 +1,63 @@
+#include "session.hpp"
+
+const char *sessionStateName(SessionState state)
+{
+	switch (state)
+	{
+	case SessionState::Dashboard:
+		return "dashboard";
+	case SessionState::Loading:
+		return "loading";
+	case SessionState::Transition:
+		return "transition";
+	default:
+		return "in-app";
+	}
+}
+
+bool SessionTracker::update(long timeMs, bool dashboardVisible)
+{
+	dashboard = dashboardVisible;
+	if (transition && timeMs >= transitionUntil)
+	{
+		transition = false;
+		return true;
+	}
+	return false;
+}
+
+SessionState SessionTracker::tag(float cpuMs, float minCpuMs)
+{
+	bool light = cpuMs < minCpuMs;
+	run = light != loading ? run + 1 : 0;
+	if (run >= loadingRunFrames)
+	{
+		loading = light;
+		run = 0;
+	}
+
+	if (transition)
+		return SessionState::Transition;
+	if (dashboard)
+		return SessionState::Dashboard;
+	if (loading || light)
+		return SessionState::Loading;
+	return SessionState::InApp;
+}
+
+void SessionTracker::beginTransition(long untilMs)
+{
+	transition = true;
+	transitionUntil = untilMs;
+}
+
+SessionState SessionTracker::state() const
+{
+	if (transition)
+		return SessionState::Transition;
+	if (dashboard)
+		return SessionState::Dashboard;
+	if (loading)
+		return SessionState::Loading;
+	return SessionState::InApp;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// What the session was doing when a frame was rendered
+enum class SessionState : uint8_t
+{
+	InApp,		// The application is rendering, the only frames decisions are made from
+	Dashboard,	// The SteamVR dashboard is open
+	Loading,	// Little to no application CPU time: loading screens, the SteamVR void
+	Transition, // Another application just started rendering
+};
+
+static constexpr size_t sessionStateCount = size_t(SessionState::Transition) + 1;
+
+const char *sessionStateName(SessionState state);
+
+// Tags frames with the state of the session. A frame under the CPU threshold
+// is loading, and once loadingRunFrames of them came in a row so is every
+// frame until as many in a row are over it again, so that the spikes of a
+// loading screen don't count as game load.
+class SessionTracker
+{
+public:
+	static constexpr uint32_t loadingRunFrames = 45;
+
+	// Runtime state of this tick, before its frames are tagged. Returns true
+	// when this tick ends a transition.
+	bool update(long timeMs, bool dashboardVisible);
+	// Tags one frame from its CPU frametime
+	SessionState tag(float cpuMs, float minCpuMs);
+	// Tags every frame as a transition until untilMs
+	void beginTransition(long untilMs);
+
+	// State as of the latest frame
+	SessionState state() const;
+
+private:
+	bool dashboard = false;
+	bool transition = false;
+	long transitionUntil = 0;
+	bool loading = false;
+	// Frames in a row on the other side of the CPU threshold than the loading state
+	uint32_t run = 0;
+};
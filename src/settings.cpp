@@ -0,0 +1,292 @@
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <fmt/core.h>
+
+#include "SimpleIni.h"
+#include "settings.hpp"
+
+// Where a key of the file lives in Settings, either directly or in its ControllerConfig
+using SettingMember = std::variant<int Settings::*, std::string Settings::*,
+								   int ControllerConfig::*, long ControllerConfig::*, float ControllerConfig::*>;
+
+struct SettingKey
+{
+	const char *section;
+	const char *key;
+	SettingMember member;
+	// Written as a percentage in the file, a ratio in memory
+	bool percent = false;
+};
+
+// Every key of the file, in the order of the shipped files. Reading and writing both go through it.
+static const SettingKey settingKeys[] = {
+	{"Initialization", "autoStart", &Settings::autoStart},
+	{"Initialization", "minimizeOnStart", &Settings::minimizeOnStart},
+	{"Initialization", "initialRes", &ControllerConfig::initialRes, true},
+	{"Initialization", "appProfiles", &Settings::appProfiles},
+	{"Initialization", "waitForSteamVR", &Settings::waitForSteamVR},
+
+	{"Resolution change", "minRes", &ControllerConfig::minRes, true},
+	{"Resolution change", "maxRes", &ControllerConfig::maxRes, true},
+	{"Resolution change", "dataPullDelayMs", &ControllerConfig::dataPullDelayMs},
+	{"Resolution change", "resChangeDelayMs", &ControllerConfig::resChangeDelayMs},
+	{"Resolution change", "adaptivePolling", &ControllerConfig::adaptivePolling},
+	{"Resolution change", "idlePollDelayMs", &ControllerConfig::idlePollDelayMs},
+	{"Resolution change", "minCpuTimeThreshold", &ControllerConfig::minCpuTimeThreshold},
+	{"Resolution change", "resIncreaseMin", &ControllerConfig::resIncreaseMin, true},
+	{"Resolution change", "resDecreaseMin", &ControllerConfig::resDecreaseMin, true},
+	{"Resolution change", "resIncreaseScale", &ControllerConfig::resIncreaseScale, true},
+	{"Resolution change", "resDecreaseScale", &ControllerConfig::resDecreaseScale, true},
+	{"Resolution change", "resIncreaseThreshold", &ControllerConfig::resIncreaseThreshold, true},
+	{"Resolution change", "resDecreaseThreshold", &ControllerConfig::resDecreaseThreshold, true},
+	{"Resolution change", "dataAverageSamples", &ControllerConfig::dataAverageSamples},
+	{"Resolution change", "dataWindowSamples", &ControllerConfig::dataWindowSamples},
+	{"Resolution change", "gpuTimePercentile", &ControllerConfig::gpuTimePercentile},
+	{"Resolution change", "resetOnThreshold", &ControllerConfig::resetOnThreshold},
+	{"Resolution change", "alwaysReproject", &ControllerConfig::alwaysReproject},
+	{"Resolution change", "vramLimit", &ControllerConfig::vramLimit, true},
+	{"Resolution change", "vramTarget", &ControllerConfig::vramTarget, true},
+	{"Resolution change", "vramMonitorEnabled", &ControllerConfig::vramMonitorEnabled},
+	{"Resolution change", "vramOnlyMode", &ControllerConfig::vramOnlyMode},
+	{"Resolution change", "vramSysfsRoot", &Settings::vramSysfsRoot},
+	{"Resolution change", "preferReprojection", &ControllerConfig::preferReprojection},
+	{"Resolution change", "ignoreCpuTime", &ControllerConfig::ignoreCpuTime},
+	{"Resolution change", "appCpuTimeOnly", &ControllerConfig::appCpuTimeOnly},
+	{"Resolution change", "controllerMode", &ControllerConfig::controllerMode},
+	{"Resolution change", "hitchCostWeight", &ControllerConfig::hitchCostWeight, true},
+	{"Resolution change", "predictiveDecrease", &ControllerConfig::predictiveDecrease},
+	{"Resolution change", "modeHysteresis", &ControllerConfig::modeHysteresis, true},
+	{"Resolution change", "modeMinDwellMs", &ControllerConfig::modeMinDwellMs},
+	{"Resolution change", "thermalMonitorEnabled", &ControllerConfig::thermalMonitorEnabled},
+	{"Resolution change", "throttleGpuTemp", &ControllerConfig::throttleGpuTemp},
+	{"Resolution change", "throttleCpuTemp", &ControllerConfig::throttleCpuTemp},
+	{"Resolution change", "throttleClockRatio", &ControllerConfig::throttleClockRatio, true},
+	{"Resolution change", "throttleReleaseMs", &ControllerConfig::throttleReleaseMs},
+	{"Resolution change", "throttleResCeiling", &ControllerConfig::throttleResCeiling, true},
+	{"Resolution change", "appTransitionMs", &ControllerConfig::appTransitionMs},
+	{"Resolution change", "outlierRejection", &ControllerConfig::outlierRejection},
+	{"Resolution change", "thermalSysfsRoot", &Settings::thermalSysfsRoot},
+
+	{"Diagnostics", "traceFile", &Settings::traceFile},
+	{"Diagnostics", "reportFile", &Settings::reportFile},
+	{"Diagnostics", "metricsSharedMemory", &Settings::metricsSharedMemory},
+	{"Diagnostics", "metricsSocket", &Settings::metricsSocket},
+};
+
+// The value of a key, const when settings is
+template <typename S, typename T>
+static auto &field(S &settings, T Settings::*member)
+{
+	return settings.*member;
+}
+
+template <typename S, typename T>
+static auto &field(S &settings, T ControllerConfig::*member)
+{
+	return settings.controller.*member;
+}
+
+// The readers below keep the current value when a key is missing,
+// and name the key when its value can't be parsed
+
+// Nothing but spaces after the number, so 256ms or 8 5 aren't read as 256 and 8
+static void checkParsed(const char *text, size_t pos)
+{
+	for (; text[pos]; pos++)
+		if (!std::isspace((unsigned char)text[pos]))
+			throw std::invalid_argument(text);
+}
+
+static void readValue(const CSimpleIniA &ini, const SettingKey &k, int &value)
+{
+	const char *text = ini.GetValue(k.section, k.key);
+	if (!text)
+		return;
+	try
+	{
+		size_t pos = 0;
+		value = std::stoi(text, &pos);
+		checkParsed(text, pos);
+	}
+	catch (const std::exception &)
+	{
+		throw std::invalid_argument(fmt::format("{} is not a whole number", k.key));
+	}
+}
+
+static void readValue(const CSimpleIniA &ini, const SettingKey &k, long &value)
+{
+	const char *text = ini.GetValue(k.section, k.key);
+	if (!text)
+		return;
+	try
+	{
+		size_t pos = 0;
+		value = std::stol(text, &pos);
+		checkParsed(text, pos);
+	}
+	catch (const std::exception &)
+	{
+		throw std::invalid_argument(fmt::format("{} is not a whole number", k.key));
+	}
+}
+
+static void readValue(const CSimpleIniA &ini, const SettingKey &k, float &value)
+{
+	const char *text = ini.GetValue(k.section, k.key);
+	if (!text)
+		return;
+	try
+	{
+		size_t pos = 0;
+		float number = std::stof(text, &pos);
+		checkParsed(text, pos);
+		// Percentages in the file, ratios in memory
+		value = k.percent ? number / 100.0f : number;
+	}
+	catch (const std::exception &)
+	{
+		throw std::invalid_argument(fmt::format("{} is not a number", k.key));
+	}
+}
+
+static void readValue(const CSimpleIniA &ini, const SettingKey &k, std::string &value)
+{
+	value = ini.GetValue(k.section, k.key, value.c_str());
+}
+
+static bool readSettings(const CSimpleIniA &ini, Settings &settings, std::string *error)
+{
+	// Get setting values, only keeping them if all of them parse
+	Settings parsed = settings;
+	try
+	{
+		for (const SettingKey &k : settingKeys)
+			std::visit([&](auto member)
+					   { readValue(ini, k, field(parsed, member)); }, k.member);
+	}
+	catch (const std::exception &e)
+	{
+		if (error)
+			*error = e.what();
+		return false;
+	}
+
+	settings = parsed;
+	return true;
+}
+
+// The writers below format values the way the shipped files have them
+
+static void writeValue(CSimpleIniA &ini, const SettingKey &k, long value)
+{
+	ini.SetLongValue(k.section, k.key, value);
+}
+
+static void writeValue(CSimpleIniA &ini, const SettingKey &k, int value)
+{
+	ini.SetLongValue(k.section, k.key, value);
+}
+
+static void writeValue(CSimpleIniA &ini, const SettingKey &k, float value)
+{
+	if (k.percent)
+		value = std::round(value * 10000.0f) / 100.0f;
+	ini.SetValue(k.section, k.key, fmt::format("{:g}", value).c_str());
+}
+
+static void writeValue(CSimpleIniA &ini, const SettingKey &k, const std::string &value)
+{
+	ini.SetValue(k.section, k.key, value.c_str());
+}
+
+static void writeSettings(CSimpleIniA &ini, const Settings &settings)
+{
+	for (const SettingKey &k : settingKeys)
+		std::visit([&](auto member)
+				   { writeValue(ini, k, field(settings, member)); }, k.member);
+}
+
+bool loadSettings(const char *path, Settings &settings, std::string *error)
+{
+	// Get ini file
+	CSimpleIniA ini;
+	SI_Error rc = ini.LoadFile(path);
+	if (rc < 0)
+	{
+		if (error)
+			*error = fmt::format("can't read {}", path);
+		return false;
+	}
+	return readSettings(ini, settings, error);
+}
+
+bool parseSettings(const std::string &text, Settings &settings, std::string *error)
+{
+	CSimpleIniA ini;
+	SI_Error rc = ini.LoadData(text.data(), text.size());
+	if (rc < 0)
+	{
+		if (error)
+			*error = "malformed settings";
+		return false;
+	}
+	return readSettings(ini, settings, error);
+}
+
+// Each FrametimeStats window is sized by these, and there are about 20 of them
+static const int maxSamples = 65536;
+
+bool validateSettings(const Settings &settings, std::string &error)
+{
+	const ControllerConfig &c = settings.controller;
+
+	if (c.minRes <= 0 || c.minRes > c.maxRes)
+		error = "minRes must be above 0 and at most maxRes";
+	else if (c.initialRes < c.minRes || c.initialRes > c.maxRes)
+		error = "initialRes must be between minRes and maxRes";
+	else if (c.resIncreaseThreshold <= 0 || c.resIncreaseThreshold > 1 || c.resDecreaseThreshold <= 0 || c.resDecreaseThreshold > 1)
+		error = "resIncreaseThreshold and resDecreaseThreshold must be within 0-100";
+	else if (c.resIncreaseThreshold > c.resDecreaseThreshold)
+		error = "resIncreaseThreshold must be at most resDecreaseThreshold";
+	else if (c.resIncreaseMin < 0 || c.resDecreaseMin < 0 || c.resIncreaseScale < 0 || c.resDecreaseScale < 0)
+		error = "resIncrease/resDecrease Min and Scale can't be negative";
+	else if (c.vramTarget < 0 || c.vramTarget > 1 || c.vramLimit < 0 || c.vramLimit > 1)
+		error = "vramTarget and vramLimit must be within 0-100";
+	else if (c.vramTarget > c.vramLimit)
+		error = "vramTarget must be at most vramLimit";
+	else if (c.dataPullDelayMs <= 0 || c.resChangeDelayMs < 0 || c.idlePollDelayMs <= 0)
+		error = "dataPullDelayMs and idlePollDelayMs must be above 0, resChangeDelayMs can't be negative";
+	else if (c.dataAverageSamples < 1 || c.dataWindowSamples < 1 || c.dataAverageSamples > maxSamples || c.dataWindowSamples > maxSamples)
+		error = fmt::format("dataAverageSamples and dataWindowSamples must be within 1-{}", maxSamples);
+	else if (c.gpuTimePercentile < 0 || c.gpuTimePercentile > 100)
+		error = "gpuTimePercentile must be within 0-100";
+	else if (c.controllerMode != 0 && c.controllerMode != 1)
+		error = "controllerMode must be 0 or 1";
+	else if (c.hitchCostWeight < 0)
+		error = "hitchCostWeight can't be negative";
+	else if (c.modeHysteresis < 0 || c.modeHysteresis >= 1 || c.modeMinDwellMs < 0)
+		error = "modeHysteresis must be within 0-99 and modeMinDwellMs can't be negative";
+	else if (c.throttleGpuTemp < 0 || c.throttleCpuTemp < 0 || c.throttleReleaseMs < 0)
+		error = "throttleGpuTemp, throttleCpuTemp and throttleReleaseMs can't be negative";
+	else if (c.throttleClockRatio < 0 || c.throttleClockRatio > 1 || c.throttleResCeiling <= 0 || c.throttleResCeiling > 1)
+		error = "throttleClockRatio must be within 0-100 and throttleResCeiling within 1-100";
+	else if (c.appTransitionMs < 0)
+		error = "appTransitionMs can't be negative";
+	else
+		return true;
+	return false;
+}
+
+bool formatSettings(const std::string &text, const Settings &settings, std::string &out)
+{
+	CSimpleIniA ini;
+	if (ini.LoadData(text.data(), text.size()) < 0)
+		return false;
+	writeSettings(ini, settings);
+	out.clear();
+	return ini.Save(out) >= 0;
+}
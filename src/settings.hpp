@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+#include "controller.hpp"
+
+struct Settings
+{
+	int autoStart = 1;
+	int minimizeOnStart = 0;
+	// Remember the resolution each application settles on and start from it next time
+	int appProfiles = 1;
+	// Wait for SteamVR to start instead of exiting when it isn't running
+	int waitForSteamVR = 1;
+	ControllerConfig controller;
+	// Prefix for the sysfs/procfs paths read for VRAM usage (empty = the real filesystem)
+	std::string vramSysfsRoot;
+	// Same for the temperature, clock and power sensors
+	std::string thermalSysfsRoot;
+	// Binary trace of every frame and decision (empty = disabled)
+	std::string traceFile;
+	// Summary of every session appended on exit (empty = disabled)
+	std::string reportFile;
+	// Live metrics for external tools (empty = disabled)
+	std::string metricsSharedMemory;
+	std::string metricsSocket;
+};
+
+// Reads the ini file at path into settings, keeping the current values for missing keys.
+// Settings are left untouched if any value can't be parsed, error says which one.
+bool loadSettings(const char *path, Settings &settings, std::string *error = nullptr);
+// Same as loadSettings, from the contents of an ini file
+bool parseSettings(const std::string &text, Settings &settings, std::string *error = nullptr);
+// Sets every value of settings in the contents of an ini file, keeping its other keys and comments
+bool formatSettings(const std::string &text, const Settings &settings, std::string &out);
+
+// Checks the ranges of the values and how they relate to each other (e.g. minRes <= initialRes <= maxRes)
+bool validateSettings(const Settings &settings, std::string &error);
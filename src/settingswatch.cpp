@@ -0,0 +1,125 @@
+#include "settingswatch.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// How often the watcher checks whether it should stop
+static constexpr int stopCheckMs = 200;
+// How often the modification time is checked without inotify
+static constexpr auto mtimePollInterval = std::chrono::seconds(1);
+
+SettingsWatcher::SettingsWatcher(std::string path, const Settings &current)
+	: path(std::move(path)), current(current)
+{
+}
+
+SettingsWatcher::~SettingsWatcher()
+{
+	stop();
+	delete pending.exchange(nullptr);
+}
+
+void SettingsWatcher::start()
+{
+	if (running)
+		return;
+	running = true;
+	thread = std::thread(&SettingsWatcher::run, this);
+}
+
+void SettingsWatcher::stop()
+{
+	running = false;
+	if (thread.joinable())
+		thread.join();
+}
+
+std::unique_ptr<SettingsUpdate> SettingsWatcher::take()
+{
+	// Cheap check first, this is called on every tick
+	if (!pending.load(std::memory_order_relaxed))
+		return nullptr;
+	return std::unique_ptr<SettingsUpdate>(pending.exchange(nullptr, std::memory_order_acquire));
+}
+
+void SettingsWatcher::reload()
+{
+	auto update = std::make_unique<SettingsUpdate>();
+	update->settings = current;
+	update->valid = loadSettings(path.c_str(), update->settings, &update->error) &&
+					validateSettings(update->settings, update->error);
+	if (update->valid)
+		current = update->settings;
+
+	// An update the loop hasn't picked up yet is superseded by this one
+	delete pending.exchange(update.release(), std::memory_order_acq_rel);
+}
+
+void SettingsWatcher::run()
+{
+	namespace fs = std::filesystem;
+	const fs::path file(path);
+
+#ifdef __linux__
+	// Watch the directory rather than the file, editors often replace the file on save
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd >= 0)
+	{
+		std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+		std::string name = file.filename().string();
+		if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) >= 0)
+		{
+			alignas(inotify_event) char buffer[4096];
+			while (running)
+			{
+				pollfd events{fd, POLLIN, 0};
+				if (poll(&events, 1, stopCheckMs) <= 0)
+					continue;
+
+				bool changed = false;
+				ssize_t size;
+				while ((size = read(fd, buffer, sizeof(buffer))) > 0)
+				{
+					for (char *p = buffer; p < buffer + size;)
+					{
+						const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+						if (event->len > 0 && name == event->name)
+							changed = true;
+						p += sizeof(inotify_event) + event->len;
+					}
+				}
+				if (changed)
+					reload();
+			}
+			close(fd);
+			return;
+		}
+		close(fd);
+	}
+#endif
+
+	// Fall back to polling the modification time
+	std::error_code error;
+	fs::file_time_type lastWrite = fs::last_write_time(file, error);
+	auto nextCheck = std::chrono::steady_clock::now() + mtimePollInterval;
+	while (running)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(stopCheckMs));
+		if (std::chrono::steady_clock::now() < nextCheck)
+			continue;
+		nextCheck += mtimePollInterval;
+
+		fs::file_time_type write = fs::last_write_time(file, error);
+		if (error || write == lastWrite)
+			continue;
+		lastWrite = write;
+		reload();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "settings.hpp"
+
+// Result of re-reading the settings file
+struct SettingsUpdate
+{
+	bool valid = false;
+	Settings settings;	 // Only meaningful when valid
+	std::string error;	 // Why the file was rejected otherwise
+};
+
+// Watches the settings file and re-reads it whenever it's written
+// (inotify on Linux, modification time polling elsewhere).
+// Parsing and validation happen on the watcher thread, the control loop only
+// picks up the finished update with take(), which is one atomic exchange.
+class SettingsWatcher
+{
+public:
+	SettingsWatcher(std::string path, const Settings &current);
+	~SettingsWatcher();
+	SettingsWatcher(const SettingsWatcher &) = delete;
+	SettingsWatcher &operator=(const SettingsWatcher &) = delete;
+
+	void start();
+	void stop();
+
+	// Latest update since the previous call, or null if the file didn't change
+	std::unique_ptr<SettingsUpdate> take();
+
+private:
+	void run();
+	void reload();
+
+	std::string path;
+	// Last accepted settings, the base for keys missing from the file
+	Settings current;
+
+	std::atomic<SettingsUpdate *> pending{nullptr};
+	std::atomic<bool> running{false};
+	std::thread thread;
+};
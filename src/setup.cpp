@@ -1,9 +1,13 @@
 #include <openvr.h>
+#include <algorithm>
+#include <chrono>
 #include <fmt/core.h>
 #include <memory>
-#include <curses.h>
+#include <thread>
 
 #include "pathtools_excerpt.h"
+#include "setup.hpp"
+#include "ui.hpp"
 
 static constexpr const char *rel_manifest_path = "./manifest.vrmanifest";
 static constexpr const char *application_key = "openvr-dynamic-resolution";
@@ -13,7 +17,35 @@ void shutdown_vr(vr::IVRSystem *_system)
 	vr::VR_Shutdown();
 }
 
-int handle_setup(bool install)
+vr::IVRSystem *init_vr(bool wait, const std::atomic<bool> &stop, vr::EVRInitError &error, int &attempts)
+{
+	auto delay = std::chrono::milliseconds(50);
+	const auto maxDelay = std::chrono::milliseconds(1000);
+	for (attempts = 1;; attempts++)
+	{
+		error = vr::VRInitError_None;
+		vr::IVRSystem *system = vr::VR_Init(&error, vr::VRApplication_Overlay);
+		if (error == vr::VRInitError_None)
+		{
+			// The compositor can come up a little after vrserver
+			if (vr::VRCompositor())
+				return system;
+			vr::VR_Shutdown();
+			error = vr::VRInitError_Init_NotInitialized;
+		}
+		if (!wait || stop)
+			return nullptr;
+		if (attempts == 1)
+			uiPrint(fmt::format("Waiting for SteamVR ({})...\n", vr::VR_GetVRInitErrorAsEnglishDescription(error)).c_str());
+
+		std::this_thread::sleep_for(delay);
+		delay = std::min(delay * 2, maxDelay);
+		if (stop)
+			return nullptr;
+	}
+}
+
+int handle_setup(bool install, std::string &message)
 {
 	// vr::EVRInitError init_error = vr::VRInitError_None;
 	// std::unique_ptr<vr::IVRSystem, decltype(&shutdown_vr)> system(vr::VR_Init(&init_error, vr::VRApplication_Utility), &shutdown_vr);
@@ -31,13 +63,12 @@ int handle_setup(bool install)
 	std::string manifest_path = Path_MakeAbsolute(rel_manifest_path, Path_StripFilename(Path_GetExecutablePath()));
 	if (install)
 	{
-		printw("Enabling auto-start...\n");
-
 		if (currently_installed)
 		{
 			if (!apps->GetApplicationAutoLaunch(application_key))
 			{
 				apps->SetApplicationAutoLaunch(application_key, true);
+				message = "Auto-start enabled";
 				return 1;
 			}
 			return 0;
@@ -46,16 +77,17 @@ int handle_setup(bool install)
 		app_error = apps->AddApplicationManifest(manifest_path.c_str());
 		if (app_error != vr::VRApplicationError_None)
 		{
-			printw("%s", fmt::format("Could not enable auto-start: {}\n", apps->GetApplicationsErrorNameFromEnum(app_error)).c_str());
+			message = fmt::format("Could not enable auto-start: {}", apps->GetApplicationsErrorNameFromEnum(app_error));
 			return 2;
 		}
 
 		app_error = apps->SetApplicationAutoLaunch(application_key, true);
 		if (app_error != vr::VRApplicationError_None)
 		{
-			printw("%s", fmt::format("Could not set auto-start: {}\n", apps->GetApplicationsErrorNameFromEnum(app_error)).c_str());
+			message = fmt::format("Could not set auto-start: {}", apps->GetApplicationsErrorNameFromEnum(app_error));
 			return 2;
 		}
+		message = "Auto-start enabled";
 		return 1;
 	}
 	else if (currently_installed)
@@ -65,8 +97,8 @@ int handle_setup(bool install)
 			return 0;
 		}
 
-		printw("Disabling auto-start...\n");
 		apps->SetApplicationAutoLaunch(application_key, false);
+		message = "Auto-start disabled";
 		return 1;
 	}
 	else
@@ -1,8 +1,18 @@
 #pragma once
 
 #include <openvr.h>
+#include <atomic>
+#include <string>
 
 // little wrapper for unique_ptr
 void shutdown_vr(vr::IVRSystem *_system);
 
-int handle_setup(bool install_manifest);
\ No newline at end of file
+// Calls VR_Init until both the runtime and its compositor are up, waiting twice as long after
+// each failure (up to a second). Without wait, gives up after the first attempt with its error,
+// and gives up as well once stop is set. Must be called from the main thread, it prints to the
+// console while waiting.
+vr::IVRSystem *init_vr(bool wait, const std::atomic<bool> &stop, vr::EVRInitError &error, int &attempts);
+
+// Installs or removes the auto-start manifest. Returns 0 if nothing changed, 1 if it did
+// and 2 on errors, with a message for the window. Doesn't print, so it can run on another thread.
+int handle_setup(bool install_manifest, std::string &message);
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <fmt/core.h>
+#include <args.hxx>
+
+#include "closedloop.hpp"
+#include "settings.hpp"
+
+int main(int argc, char *argv[])
+{
+	args::ArgumentParser parser("Runs the resolution controller in closed loop against a simulated compositor.",
+								"Prints one CSV row of convergence and stability metrics per scenario.");
+	args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
+	args::ValueFlag<std::string> settingsPath(parser, "file", "Settings file to load", {'s', "settings"}, "settings.ini");
+	args::ValueFlag<std::string> scenario(parser, "name", "Only run this scenario (steady, bursty, scene-change, ramp, manual-step, cpu-bound)", {"scenario"});
+	args::ValueFlag<float> hz(parser, "hz", "Simulated HMD refresh rate", {"hz"}, 90.0f);
+	args::ValueFlag<double> duration(parser, "seconds", "Simulated time per scenario", {"duration"}, 300.0);
+	args::ValueFlag<unsigned> seed(parser, "seed", "Random seed", {"seed"}, 1);
+	args::ValueFlag<double> maxMissed(parser, "ratio", "Fail if any scenario misses more than this ratio of frames", {"max-missed"}, 1.0);
+	args::ValueFlag<unsigned> maxOscillations(parser, "count", "Fail if any scenario oscillates more than this many times", {"max-oscillations"}, 1000000);
+
+	try
+	{
+		parser.ParseCLI(argc, argv);
+	}
+	catch (const args::Help &)
+	{
+		std::cout << parser;
+		return 0;
+	}
+	catch (const args::Error &e)
+	{
+		std::cerr << e.what() << std::endl
+				  << parser;
+		return 1;
+	}
+
+	Settings settings;
+	if (!loadSettings(args::get(settingsPath).c_str(), settings))
+		fmt::print(stderr, "Could not load {}, using defaults\n", args::get(settingsPath));
+
+	std::vector<std::string> names = simScenarioNames();
+	if (scenario)
+		names = {args::get(scenario)};
+
+	bool failed = false;
+	fmt::print("scenario,frames,ticks,averageRes,missedFrameRatio,changes,oscillations,timeToTargetS,overshoot,skippedChanges,hitchFrames,predictions,confirmedPredictions,chainedPredictions,rateModeSwitches,wallMs\n");
+	for (const std::string &name : names)
+	{
+		SimConfig sim;
+		if (!simScenario(name, args::get(hz), sim))
+		{
+			fmt::print(stderr, "Unknown scenario {}\n", name);
+			return 1;
+		}
+		sim.seed = args::get(seed);
+
+		ClosedLoopResult result = runClosedLoop(settings.controller, sim, args::get(duration));
+		fmt::print("{},{},{},{:.3f},{:.4f},{},{},{:.2f},{:.3f},{},{:.2f},{},{},{},{},{:.1f}\n", name, result.frames, result.ticks, result.averageRes,
+				   result.missedFrameRatio, result.changes, result.oscillations, result.timeToTargetS, result.overshoot,
+				   result.skippedChanges, result.hitchFrames, result.predictions, result.confirmedPredictions, result.chainedPredictions, result.rateModeSwitches, result.wallMs);
+
+		if (result.missedFrameRatio > args::get(maxMissed) || result.oscillations > args::get(maxOscillations))
+		{
+			fmt::print(stderr, "{} is over the limits\n", name);
+			failed = true;
+		}
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+#include "simruntime.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "reprojection.hpp"
+
+// Compositor work, which doesn't depend on the application
+static constexpr float compositorGpuMs = 0.5f;
+static constexpr float compositorCpuMs = 0.3f;
+
+SimRuntime::SimRuntime(const SimConfig &config)
+	: cfg(config),
+	  rng(config.seed),
+	  jitter(0.0f, config.noise),
+	  chance(0.0f, 1.0f)
+{
+	constantPhase.durationS = 1e9;
+	constantPhase.cpuMs = config.cpuMs;
+}
+
+const SimPhase &SimRuntime::currentPhase() const
+{
+	if (cfg.phases.empty())
+		return constantPhase;
+	return cfg.phases[phaseCount % cfg.phases.size()];
+}
+
+float SimRuntime::currentLoad() const
+{
+	const SimPhase &phase = currentPhase();
+	double elapsedS = (nextFrameMs - phaseStartMs) / 1000.0;
+	if (phase.rampS <= 0 || elapsedS >= phase.rampS)
+		return phase.gpuLoad;
+
+	float previous = phaseCount > 0 ? cfg.phases[(phaseCount - 1) % cfg.phases.size()].gpuLoad : 1.0f;
+	return previous + (phase.gpuLoad - previous) * float(elapsedS / phase.rampS);
+}
+
+float SimRuntime::resolutionFor(float gpuMs) const
+{
+	float perRes = (cfg.gpuMs - cfg.gpuFixedMs) * currentLoad();
+	if (perRes <= 0)
+		return 0.0f;
+	return std::max(0.0f, (gpuMs - compositorGpuMs - cfg.gpuFixedMs) / perRes);
+}
+
+void SimRuntime::setSupersampleScale(float newRes)
+{
+	if (newRes != res)
+		hitchFramesLeft = cfg.changeHitchFrames;
+	res = newRes;
+}
+
+void SimRuntime::advance(double ms)
+{
+	timeMs += ms;
+	while (nextFrameMs <= timeMs)
+	{
+		// Move on to the next phase when this one is over
+		while (nextFrameMs - phaseStartMs >= currentPhase().durationS * 1000.0)
+		{
+			phaseStartMs += currentPhase().durationS * 1000.0;
+			phaseCount++;
+			if (currentPhase().userRes > 0)
+				setSupersampleScale(currentPhase().userRes);
+		}
+		presentFrame();
+	}
+}
+
+void SimRuntime::presentFrame()
+{
+	const SimPhase &phase = currentPhase();
+	double vsyncMs = 1000.0 / cfg.refreshHz;
+
+	float gpuTime = cfg.gpuFixedMs + (cfg.gpuMs - cfg.gpuFixedMs) * currentLoad() * res;
+	gpuTime *= std::max(0.1f, 1.0f + jitter(rng));
+	if (cfg.spikeChance > 0 && chance(rng) < cfg.spikeChance)
+		gpuTime += cfg.spikeMs;
+	if (hitchFramesLeft > 0)
+	{
+		gpuTime += cfg.changeHitchMs;
+		hitchFramesLeft--;
+	}
+	float cpuTime = phase.cpuMs * std::max(0.1f, 1.0f + jitter(rng));
+
+	// A frame that misses vsync is shown again until the next one is ready
+	float slowest = std::max(gpuTime + compositorGpuMs, cpuTime + compositorCpuMs);
+	uint32_t presents = std::max(1u, uint32_t(std::ceil(slowest / vsyncMs)));
+
+	FrameSample &frame = history[frameIndex % historySize];
+	frame = FrameSample();
+	frame.frameIndex = frameIndex;
+	frame.numFramePresents = presents;
+	frame.numDroppedFrames = presents - 1;
+	if (presents > 1)
+		frame.reprojectionFlags = reprojectionAsync | (cpuTime > gpuTime ? reprojectionReasonCpu : reprojectionReasonGpu);
+	frame.systemTimeInSeconds = nextFrameMs / 1000.0;
+	frame.preSubmitGpuMs = gpuTime;
+	frame.totalRenderGpuMs = gpuTime + compositorGpuMs;
+	frame.compositorRenderGpuMs = compositorGpuMs;
+	frame.compositorRenderCpuMs = compositorCpuMs;
+	frame.compositorIdleCpuMs = std::max(0.0f, float(vsyncMs) - compositorCpuMs);
+	frame.clientFrameIntervalMs = float(presents * vsyncMs);
+	frame.submitFrameMs = 0.2f;
+	frame.newPosesReadyMs = 0.0f;
+	frame.newFrameReadyMs = cpuTime;
+	frame.numVSyncsReadyForUse = 1;
+	frame.numVSyncsToFirstView = presents;
+
+	frameIndex++;
+	nextFrameMs += presents * vsyncMs;
+}
+
+void SimRuntime::getRecommendedRenderTargetSize(uint32_t &width, uint32_t &height)
+{
+	// The supersample scale multiplies the pixel count
+	width = uint32_t(cfg.renderWidth * std::sqrt(res));
+	height = uint32_t(cfg.renderHeight * std::sqrt(res));
+}
+
+bool SimRuntime::getFrameTiming(FrameSample &frame)
+{
+	if (frameIndex == 0)
+		return false;
+	frame = history[(frameIndex - 1) % historySize];
+	return true;
+}
+
+uint32_t SimRuntime::getFrameTimings(FrameSample *frames, uint32_t count)
+{
+	count = std::min({count, frameIndex, uint32_t(historySize)});
+	for (uint32_t i = 0; i < count; i++)
+		frames[i] = history[(frameIndex - count + i) % historySize];
+	return count;
+}
+
+bool SimRuntime::getApplicationKey(uint32_t pid, char *key, uint32_t size)
+{
+	if (pid != getSceneProcessId() || pid == 0 || size <= cfg.appKey.size())
+		return false;
+	std::memcpy(key, cfg.appKey.c_str(), cfg.appKey.size() + 1);
+	return true;
+}
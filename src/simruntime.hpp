@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "runtime.hpp"
+
+// A stretch of the simulated session with its own load
+struct SimPhase
+{
+	double durationS = 30.0;
+	// Multiplier of the resolution-dependent GPU work
+	float gpuLoad = 1.0f;
+	// Application CPU frametime
+	float cpuMs = 5.0f;
+	// Seconds over which gpuLoad moves from the previous phase's load (0 = at once)
+	double rampS = 0.0;
+	// Resolution the user sets with the SteamVR slider when the phase starts (0 = left alone)
+	float userRes = 0.0f;
+};
+
+struct SimConfig
+{
+	float refreshHz = 90.0f;
+	// Per-eye render target size at 100% resolution
+	uint32_t renderWidth = 2016;
+	uint32_t renderHeight = 2240;
+	// GPU frametime at 100% resolution and a load of 1
+	float gpuMs = 8.0f;
+	// Part of gpuMs that doesn't scale with the pixel count
+	float gpuFixedMs = 1.0f;
+	// Application CPU frametime when there are no phases
+	float cpuMs = 5.0f;
+	// Relative standard deviation of the frametimes
+	float noise = 0.05f;
+	// Chance for any frame to be a scene-load spike, and how much GPU time it adds
+	float spikeChance = 0.0f;
+	float spikeMs = 10.0f;
+	// Extra GPU time on the frames following a resolution change (render target reallocation)
+	float changeHitchMs = 4.0f;
+	uint32_t changeHitchFrames = 3;
+	bool dashboardVisible = false;
+	// Application key of the simulated game (empty = no scene application)
+	std::string appKey;
+	// Played in a loop; empty means a constant load of 1
+	std::vector<SimPhase> phases;
+	unsigned seed = 1;
+};
+
+// Simulated compositor. GPU frametime scales with the supersample scale (the
+// rendered pixel count), frames that miss vsync are reprojected, and the
+// runtime reacts to setSupersampleScale() like SteamVR does.
+// Time only moves forward through advance(), so it can run faster than real time.
+class SimRuntime : public Runtime
+{
+public:
+	explicit SimRuntime(const SimConfig &config);
+
+	// Simulates the compositor for ms milliseconds
+	void advance(double ms);
+	double nowMs() const { return timeMs; }
+
+	// Index of the phase being played (counting from the start, not wrapped)
+	size_t phaseNumber() const { return phaseCount; }
+	const SimPhase &currentPhase() const;
+	// GPU load right now, along the ramp of the current phase
+	float currentLoad() const;
+
+	// Resolution at which the average total GPU frametime would be gpuMs in the current phase
+	float resolutionFor(float gpuMs) const;
+
+	bool getFrameTiming(FrameSample &frame) override;
+	uint32_t getFrameTimings(FrameSample *frames, uint32_t count) override;
+
+	float getSupersampleScale() override { return res; }
+	void setSupersampleScale(float res) override;
+
+	void getRecommendedRenderTargetSize(uint32_t &width, uint32_t &height) override;
+	float getDisplayFrequency() override { return cfg.refreshHz; }
+	bool isDashboardVisible() override { return cfg.dashboardVisible; }
+	uint32_t getSceneProcessId() override { return cfg.appKey.empty() ? 0 : 1; }
+	bool getApplicationKey(uint32_t pid, char *key, uint32_t size) override;
+
+private:
+	void presentFrame();
+
+	static constexpr size_t historySize = 256;
+
+	SimConfig cfg;
+	SimPhase constantPhase;
+	std::mt19937 rng;
+	std::normal_distribution<float> jitter;
+	std::uniform_real_distribution<float> chance;
+
+	std::array<FrameSample, historySize> history{};
+	uint32_t frameIndex = 0;
+	uint32_t hitchFramesLeft = 0;
+	float res = 1.0f;
+	double timeMs = 0.0;
+	double nextFrameMs = 0.0;
+	double phaseStartMs = 0.0;
+	size_t phaseCount = 0;
+};
@@ -0,0 +1,108 @@
+#include "stats.hpp"
+
+#include <algorithm>
+
+FrametimeStats::FrametimeStats(size_t windowSamples, size_t averageSamples)
+	: samples(std::max<size_t>({windowSamples, averageSamples, 1})),
+	  histogram(binCount, 0),
+	  averageSamples(std::max<size_t>(averageSamples, 1))
+{
+}
+
+size_t FrametimeStats::binOf(float ms) const
+{
+	if (ms <= 0.0f)
+		return 0;
+	return std::min(size_t(ms / binWidthMs), binCount - 1);
+}
+
+void FrametimeStats::push(float ms)
+{
+	size_t cap = samples.size();
+
+	// Evict the oldest sample of the window once it is full
+	if (count == cap)
+		histogram[binOf(samples[head])]--;
+	else
+		count++;
+
+	// Evict the sample leaving the averaging span
+	if (averageCount == averageSamples)
+		averageSum -= samples[(head + cap - averageSamples) % cap];
+	else
+		averageCount++;
+
+	samples[head] = ms;
+	histogram[binOf(ms)]++;
+	averageSum += ms;
+
+	head = (head + 1) % cap;
+
+	// Recompute the running sum once per lap so rounding errors can't pile up
+	if (head == 0)
+	{
+		averageSum = 0.0;
+		for (size_t i = 0; i < averageCount; i++)
+			averageSum += samples[(cap - 1 - i) % cap];
+	}
+}
+
+void FrametimeStats::clear()
+{
+	std::fill(histogram.begin(), histogram.end(), 0);
+	head = 0;
+	count = 0;
+	averageCount = 0;
+	averageSum = 0.0;
+}
+
+void FrametimeStats::resize(size_t windowSamples, size_t averageSamples)
+{
+	FrametimeStats resized(windowSamples, averageSamples);
+	if (resized.capacity() == capacity() && resized.averageSamples == this->averageSamples)
+		return;
+
+	// Replay the newest samples, oldest first
+	size_t cap = samples.size();
+	size_t keep = std::min(count, resized.capacity());
+	for (size_t i = keep; i > 0; i--)
+		resized.push(samples[(head + cap - i) % cap]);
+	*this = std::move(resized);
+}
+
+float FrametimeStats::average() const
+{
+	if (averageCount == 0)
+		return 0.0f;
+	return float(averageSum / averageCount);
+}
+
+float FrametimeStats::percentile(float p) const
+{
+	if (count == 0)
+		return 0.0f;
+
+	// Rank of the wanted sample, then find the bin holding it
+	float rank = std::clamp(p, 0.0f, 100.0f) / 100.0f * count;
+	uint32_t seen = 0;
+	for (size_t bin = 0; bin < binCount; bin++)
+	{
+		if (histogram[bin] == 0)
+			continue;
+		if (seen + histogram[bin] >= rank)
+		{
+			// Interpolate within the bin
+			float within = (rank - seen) / histogram[bin];
+			return (bin + within) * binWidthMs;
+		}
+		seen += histogram[bin];
+	}
+	return binCount * binWidthMs;
+}
+
+float FrametimeStats::latest() const
+{
+	if (count == 0)
+		return 0.0f;
+	return samples[(head + samples.size() - 1) % samples.size()];
+}
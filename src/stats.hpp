@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-capacity window of frametimes.
+// Pushing a sample is O(1): the mean is kept as a running sum over the newest
+// averageSamples entries, and percentiles come from a histogram of the whole
+// window that is updated as samples enter and leave it.
+class FrametimeStats
+{
+public:
+	// Histogram resolution and range; anything slower lands in the last bin
+	static constexpr float binWidthMs = 0.1f;
+	static constexpr size_t binCount = 1024;
+
+	FrametimeStats(size_t windowSamples, size_t averageSamples);
+
+	void push(float ms);
+	void clear();
+	// Changes the window and averaging sizes, keeping the newest samples that still fit
+	void resize(size_t windowSamples, size_t averageSamples);
+
+	// Number of samples currently in the window
+	size_t size() const { return count; }
+	size_t capacity() const { return samples.size(); }
+
+	// Mean of the newest averageSamples samples (0 if empty)
+	float average() const;
+	// Percentile (0-100) over the whole window (0 if empty)
+	float percentile(float p) const;
+	// Newest sample (0 if empty)
+	float latest() const;
+
+private:
+	size_t binOf(float ms) const;
+
+	std::vector<float> samples;
+	std::vector<uint32_t> histogram;
+	size_t head = 0; // next slot to write
+	size_t count = 0;
+	size_t averageSamples;
+	size_t averageCount = 0;
+	double averageSum = 0.0;
+};
@@ -0,0 +1,91 @@
+#include "sysfs.hpp"
+
+#include <cstdlib>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SysfsFile::~SysfsFile()
+{
+	close();
+}
+
+SysfsFile::SysfsFile(SysfsFile &&other) noexcept : fd(other.fd)
+{
+	other.fd = -1;
+}
+
+SysfsFile &SysfsFile::operator=(SysfsFile &&other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		fd = other.fd;
+		other.fd = -1;
+	}
+	return *this;
+}
+
+bool SysfsFile::open(const std::string &path)
+{
+	return open(path.c_str());
+}
+
+bool SysfsFile::open(const char *path)
+{
+	close();
+#ifdef __linux__
+	fd = ::open(path, O_RDONLY | O_CLOEXEC);
+#endif
+	return fd >= 0;
+}
+
+void SysfsFile::close()
+{
+#ifdef __linux__
+	if (fd >= 0)
+		::close(fd);
+#endif
+	fd = -1;
+}
+
+long SysfsFile::read(char *buffer, size_t size) const
+{
+	if (fd < 0 || size == 0)
+		return -1;
+#ifdef __linux__
+	// Reading from offset 0 makes the kernel regenerate the attribute
+	ssize_t length = pread(fd, buffer, size - 1, 0);
+	if (length < 0)
+		return -1;
+	buffer[length] = '\0';
+	return long(length);
+#else
+	return -1;
+#endif
+}
+
+bool SysfsFile::readUint64(uint64_t &value) const
+{
+	char buffer[32];
+	if (read(buffer, sizeof(buffer)) <= 0)
+		return false;
+	char *end = nullptr;
+	value = std::strtoull(buffer, &end, 10);
+	return end != buffer;
+}
+
+bool readSysfsUint64(const std::string &path, uint64_t &value)
+{
+	SysfsFile file;
+	return file.open(path) && file.readUint64(value);
+}
+
+std::string sysfsPath(const std::string &root, const char *path)
+{
+	std::string result = root;
+	while (!result.empty() && result.back() == '/')
+		result.pop_back();
+	return result + path;
+}
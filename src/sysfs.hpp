@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Small attribute file (sysfs, procfs) kept open so that every read is a single pread.
+// Only functional on Linux; elsewhere open() always fails.
+class SysfsFile
+{
+public:
+	SysfsFile() = default;
+	~SysfsFile();
+	SysfsFile(const SysfsFile &) = delete;
+	SysfsFile &operator=(const SysfsFile &) = delete;
+	SysfsFile(SysfsFile &&other) noexcept;
+	SysfsFile &operator=(SysfsFile &&other) noexcept;
+
+	bool open(const std::string &path);
+	bool open(const char *path);
+	void close();
+	bool isOpen() const { return fd >= 0; }
+
+	// Reads the whole attribute into buffer (null-terminated), returns the length or -1
+	long read(char *buffer, size_t size) const;
+	// Reads the attribute as a decimal integer
+	bool readUint64(uint64_t &value) const;
+
+private:
+	int fd = -1;
+};
+
+// One-shot read of a decimal integer attribute
+bool readSysfsUint64(const std::string &path, uint64_t &value);
+
+// Joins a configurable root with an absolute path ("" or "/" means the real filesystem)
+std::string sysfsPath(const std::string &root, const char *path);
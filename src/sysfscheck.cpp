@@ -0,0 +1,281 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <fmt/core.h>
+#include <args.hxx>
+
+#include "thermal.hpp"
+#include "vram.hpp"
+
+namespace fs = std::filesystem;
+
+// Builds a fake sysfs/procfs tree and checks what the readers that take a root make of it
+class Fixture
+{
+public:
+	explicit Fixture(fs::path root) : root(std::move(root)) {}
+	~Fixture()
+	{
+		std::error_code ec;
+		fs::remove_all(root, ec);
+	}
+
+	const fs::path &path() const { return root; }
+
+	// Writes a file under the root, creating its directories
+	void write(const std::string &path, const std::string &text) const
+	{
+		fs::path file = root / path;
+		fs::create_directories(file.parent_path());
+		std::ofstream(file, std::ios::binary) << text;
+	}
+
+	void remove(const std::string &path) const
+	{
+		std::error_code ec;
+		fs::remove(root / path, ec);
+	}
+
+private:
+	fs::path root;
+};
+
+static int failures = 0;
+
+static void check(bool ok, const std::string &what)
+{
+	if (!ok)
+	{
+		fmt::print(stderr, "FAILED: {}\n", what);
+		failures++;
+	}
+}
+
+static void checkVram(const Fixture &fixture)
+{
+	const uint64_t mib = 1 << 20;
+	// An integrated GPU next to the discrete one, the one with more VRAM is picked
+	fixture.write("sys/class/drm/card0/device/mem_info_vram_total", fmt::format("{}\n", 512 * mib));
+	fixture.write("sys/class/drm/card0/device/mem_info_vram_used", fmt::format("{}\n", 100 * mib));
+	fixture.write("sys/class/drm/card1/device/mem_info_vram_total", fmt::format("{}\n", 16384 * mib));
+	fixture.write("sys/class/drm/card1/device/mem_info_vram_used", fmt::format("{}\n", 4096 * mib));
+	// Connectors aren't cards
+	fixture.write("sys/class/drm/card1-DP-1/device/mem_info_vram_total", fmt::format("{}\n", 32768 * mib));
+
+	// A game with two descriptors of the same DRM client, one of another and a plain file
+	fixture.write("proc/1234/fdinfo/3", "pos:\t0\nflags:\t02100002\ndrm-driver:\tamdgpu\ndrm-client-id:\t7\ndrm-memory-vram:\t1048576 KiB\n");
+	fixture.write("proc/1234/fdinfo/4", "pos:\t0\nflags:\t02100002\ndrm-driver:\tamdgpu\ndrm-client-id:\t7\ndrm-memory-vram:\t1048576 KiB\n");
+	fixture.write("proc/1234/fdinfo/5", "pos:\t0\ndrm-driver:\tamdgpu\ndrm-client-id:\t8\ndrm-resident-vram:\t512 MiB\ndrm-memory-vram:\t1 MiB\n");
+	fixture.write("proc/1234/fdinfo/6", "pos:\t0\nflags:\t0100000\nmnt_id:\t25\n");
+
+	SysfsVramProvider provider(fixture.path().string());
+	check(provider.valid(), "VRAM: a card is found");
+	check(std::string(provider.name()) == "card1", fmt::format("VRAM: the card with the most VRAM is picked (got {})", provider.name()));
+
+	VramInfo info;
+	check(provider.read(info), "VRAM: usage is read");
+	check(info.usedBytes == 4096 * mib && info.totalBytes == 16384 * mib,
+		  fmt::format("VRAM: usage is 4096 of 16384 MiB (got {} of {})", info.usedBytes / mib, info.totalBytes / mib));
+
+	// Read again on every call, the file is kept open
+	fixture.write("sys/class/drm/card1/device/mem_info_vram_used", fmt::format("{}\n", 8192 * mib));
+	check(provider.read(info) && info.usedBytes == 8192 * mib, "VRAM: a changed usage is read");
+
+	uint64_t bytes = 0;
+	check(provider.processUsage(1234, bytes), "VRAM: the game's usage is known");
+	check(bytes == 1536 * mib, fmt::format("VRAM: the game holds 1536 MiB over two clients (got {})", bytes / mib));
+	check(!provider.processUsage(4321, bytes), "VRAM: a process without DRM descriptors is unknown");
+	check(!provider.processUsage(0, bytes), "VRAM: no process is unknown");
+
+	uint64_t clientId = 0, vramBytes = 0;
+	check(!parseDrmFdinfo("pos:\t0\nflags:\t0100000\n", clientId, vramBytes), "fdinfo: a plain file isn't a DRM client");
+	check(parseDrmFdinfo("drm-client-id:\t12\ndrm-resident-vram:\t3 GiB", clientId, vramBytes) && clientId == 12 && vramBytes == 3072 * mib,
+		  "fdinfo: the last line doesn't need a newline");
+
+	fixture.remove("sys/class/drm/card0/device/mem_info_vram_used");
+	fixture.remove("sys/class/drm/card1/device/mem_info_vram_used");
+	check(!SysfsVramProvider(fixture.path().string()).valid(), "VRAM: cards without a usage file are skipped");
+}
+
+// Feeds the detector what the sampler reads from the fixture, once per tick
+struct ThrottleRun
+{
+	const ThermalSampler &sampler;
+	ThrottleDetector detector;
+	ThrottleInput input;
+	long tickMs = 200;
+
+	explicit ThrottleRun(const ThermalSampler &sampler) : sampler(sampler)
+	{
+		input.gpuTempLimit = 90.0f;
+		input.cpuTempLimit = 95.0f;
+		input.clockRatio = 0.8f;
+		input.releaseMs = 1000;
+	}
+
+	bool tick(bool gpuBusy)
+	{
+		input.timeMs += tickMs;
+		input.gpuBusy = gpuBusy;
+		sampler.read(input.sample);
+		return detector.update(input);
+	}
+
+	// Ticks until one throttles, at most count
+	int ticksToThrottle(int count, bool gpuBusy)
+	{
+		for (int i = 1; i <= count; i++)
+		{
+			if (tick(gpuBusy))
+				return i;
+		}
+		return 0;
+	}
+};
+
+static void checkThermal(const Fixture &fixture)
+{
+	// A discrete amdgpu card: hwmon in millidegrees, Hz and microwatts, DPM levels in MHz
+	const std::string hwmon = "sys/class/drm/card0/device/hwmon/hwmon3/";
+	fixture.write("sys/class/drm/card0/device/mem_info_vram_total", "17163091968\n");
+	fixture.write("sys/class/drm/card0/device/pp_dpm_sclk", "0: 500Mhz\n1: 1200Mhz\n2: 2615Mhz *\n");
+	fixture.write(hwmon + "temp1_label", "edge\n");
+	fixture.write(hwmon + "temp1_input", "65000\n");
+	fixture.write(hwmon + "temp2_label", "junction\n");
+	fixture.write(hwmon + "temp2_input", "80000\n");
+	fixture.write(hwmon + "freq1_input", "2500000000\n");
+	fixture.write(hwmon + "power1_average", "200000000\n");
+	fixture.write(hwmon + "power1_cap", "300000000\n");
+	// The CPU package, Tdie preferred over Tctl, and cores in kHz
+	fixture.write("sys/class/hwmon/hwmon0/name", "k10temp\n");
+	fixture.write("sys/class/hwmon/hwmon0/temp1_label", "Tctl\n");
+	fixture.write("sys/class/hwmon/hwmon0/temp1_input", "78000\n");
+	fixture.write("sys/class/hwmon/hwmon0/temp2_label", "Tdie\n");
+	fixture.write("sys/class/hwmon/hwmon0/temp2_input", "68000\n");
+	fixture.write("sys/class/hwmon/hwmon1/name", "nvme\n");
+	fixture.write("sys/class/hwmon/hwmon1/temp1_input", "99000\n");
+	fixture.write("sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "3000000\n");
+	fixture.write("sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", "5000000\n");
+	fixture.write("sys/devices/system/cpu/cpu1/cpufreq/scaling_cur_freq", "4500000\n");
+	fixture.write("sys/devices/system/cpu/cpu1/cpufreq/cpuinfo_max_freq", "5000000\n");
+
+	ThermalSampler sampler(fixture.path().string());
+	check(sampler.valid(), "Thermal: sensors are found");
+	ThermalSample s;
+	check(sampler.read(s), "Thermal: sensors are read");
+	check(s.gpuTempC == 65.0f, fmt::format("Thermal: GPU edge temperature is 65C (got {})", s.gpuTempC));
+	check(s.gpuClockMhz == 2500.0f && s.gpuMaxClockMhz == 2615.0f,
+		  fmt::format("Thermal: GPU clock is 2500 of 2615 MHz (got {} of {})", s.gpuClockMhz, s.gpuMaxClockMhz));
+	check(s.gpuPowerW == 200.0f && s.gpuPowerCapW == 300.0f,
+		  fmt::format("Thermal: GPU draws 200 of 300 W (got {} of {})", s.gpuPowerW, s.gpuPowerCapW));
+	check(s.cpuTempC == 68.0f, fmt::format("Thermal: CPU Tdie is 68C (got {})", s.cpuTempC));
+	check(s.cpuClockMhz == 4500.0f && s.cpuMaxClockMhz == 5000.0f,
+		  fmt::format("Thermal: fastest core is 4500 of 5000 MHz (got {} of {})", s.cpuClockMhz, s.cpuMaxClockMhz));
+
+	// Busy at full clock, under every limit
+	{
+		ThrottleRun run(sampler);
+		check(run.ticksToThrottle(20, true) == 0, "Throttle: a busy GPU at full clock doesn't throttle");
+	}
+
+	// Temperature: at the limit right away, over once 5 degrees cooler for releaseMs
+	{
+		ThrottleRun run(sampler);
+		fixture.write(hwmon + "temp1_input", "91000\n");
+		check(run.tick(false) && run.detector.reasons() == throttleGpuTemp, "Throttle: GPU at its temperature limit");
+		fixture.write(hwmon + "temp1_input", "87000\n");
+		check(run.tick(false) && run.detector.reasons() == throttleGpuTemp, "Throttle: GPU 3 degrees under the limit is still hot");
+		fixture.write(hwmon + "temp1_input", "84000\n");
+		check(run.tick(false) && run.detector.reasons() == 0, "Throttle: GPU cooled down, held for releaseMs");
+		for (int i = 0; i < 4; i++)
+			run.tick(false);
+		check(!run.tick(false) && run.detector.events() == 1, "Throttle: GPU temperature throttling is over after releaseMs");
+		fixture.write(hwmon + "temp1_input", "65000\n");
+
+		fixture.write("sys/class/hwmon/hwmon0/temp2_input", "96000\n");
+		check(run.tick(false) && run.detector.reasons() == throttleCpuTemp, "Throttle: CPU at its temperature limit");
+		fixture.write("sys/class/hwmon/hwmon0/temp2_input", "68000\n");
+	}
+
+	// Clock ratio: a busy GPU held under 80% of its highest clock, only once it stays there
+	{
+		ThrottleRun run(sampler);
+		fixture.write(hwmon + "freq1_input", "1200000000\n");
+		check(run.ticksToThrottle(20, false) == 0, "Throttle: an idle GPU in a low clock state doesn't throttle");
+
+		// Clocking up from a low power state after the load came back
+		int dips = 0;
+		for (int i = 0; i < 12; i++)
+		{
+			fixture.write(hwmon + "freq1_input", i % 4 == 3 ? "2500000000\n" : "1200000000\n");
+			dips += run.tick(true);
+		}
+		check(dips == 0, "Throttle: short low clock states of a busy GPU don't throttle");
+
+		fixture.write(hwmon + "freq1_input", "1200000000\n");
+		int ticks = run.ticksToThrottle(20, true);
+		int expected = int(ThrottleDetector::lowClockMs / run.tickMs) + 1;
+		check(ticks == expected, fmt::format("Throttle: a busy GPU kept at a low clock throttles after {} ticks of 200 ms (got {})", expected, ticks));
+		check(run.detector.reasons() == throttleGpuClock, "Throttle: the low clock is blamed on the clock, not the power cap");
+		fixture.write(hwmon + "freq1_input", "2500000000\n");
+	}
+
+	// The same low clock lasts as long when the poll delay grows while the frametimes are stable
+	{
+		ThrottleRun run(sampler);
+		run.tickMs = 500;
+		fixture.write(hwmon + "freq1_input", "1200000000\n");
+		int ticks = run.ticksToThrottle(20, true);
+		int expected = int(ThrottleDetector::lowClockMs / run.tickMs) + 1;
+		check(ticks == expected, fmt::format("Throttle: a busy GPU kept at a low clock throttles after {} ticks of 500 ms (got {})", expected, ticks));
+		fixture.write(hwmon + "freq1_input", "2500000000\n");
+	}
+
+	// Power cap: the same low clock while drawing all of the cap
+	{
+		ThrottleRun run(sampler);
+		fixture.write(hwmon + "freq1_input", "1800000000\n");
+		fixture.write(hwmon + "power1_average", "295000000\n");
+		int ticks = run.ticksToThrottle(20, true);
+		int expected = int(ThrottleDetector::lowClockMs / run.tickMs) + 1;
+		check(ticks == expected && run.detector.reasons() == throttleGpuPower,
+			  fmt::format("Throttle: a busy GPU at its power cap throttles after {} ticks (got {})", expected, ticks));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	args::ArgumentParser parser("Checks the VRAM and sensor readers, and throttling detection, against a fake sysfs and procfs tree.",
+								"Builds the tree in a temporary directory, prints what doesn't match and fails if anything doesn't.");
+	args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
+	try
+	{
+		parser.ParseCLI(argc, argv);
+	}
+	catch (const args::Help &)
+	{
+		std::cout << parser;
+		return 0;
+	}
+	catch (const args::Error &e)
+	{
+		std::cerr << e.what() << std::endl
+				  << parser;
+		return 1;
+	}
+
+	fs::path root = fs::temp_directory_path() / fmt::format("sysfscheck-{}", std::chrono::steady_clock::now().time_since_epoch().count());
+	checkVram(Fixture(root / "vram"));
+	checkThermal(Fixture(root / "thermal"));
+	std::error_code ec;
+	fs::remove(root, ec);
+
+	if (failures > 0)
+		return 1;
+	fmt::print("All checks passed\n");
+	return 0;
+}
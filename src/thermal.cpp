@@ -0,0 +1,316 @@
+#include "thermal.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <initializer_list>
+#include <fmt/format.h>
+
+namespace fs = std::filesystem;
+
+// Reads a small text attribute without its trailing newline
+static bool readSysfsText(const std::string &path, char *text, size_t size)
+{
+	SysfsFile file;
+	long length = file.open(path) ? file.read(text, size) : -1;
+	if (length <= 0)
+		return false;
+	while (length > 0 && std::isspace((unsigned char)text[length - 1]))
+		text[--length] = '\0';
+	return true;
+}
+
+// Directory of the first hwmon device under dir, with a trailing slash (empty if none)
+static std::string findHwmon(const std::string &dir)
+{
+	std::error_code ec;
+	for (const fs::directory_entry &entry : fs::directory_iterator(dir, ec))
+	{
+		if (entry.path().filename().string().compare(0, 5, "hwmon") == 0)
+			return entry.path().string() + "/";
+	}
+	return "";
+}
+
+// Input of the temperature with the first of labels found, temp1 if none of them is there
+static std::string findTemp(const std::string &hwmon, std::initializer_list<const char *> labels)
+{
+	int best = 1;
+	size_t bestRank = labels.size();
+	for (int i = 1; i <= 16; i++)
+	{
+		char label[64];
+		if (!readSysfsText(hwmon + "temp" + std::to_string(i) + "_label", label, sizeof(label)))
+			continue;
+		size_t rank = 0;
+		for (const char *wanted : labels)
+		{
+			if (std::strcmp(label, wanted) == 0)
+				break;
+			rank++;
+		}
+		if (rank < bestRank)
+		{
+			bestRank = rank;
+			best = i;
+		}
+	}
+	return "temp" + std::to_string(best) + "_input";
+}
+
+// Highest level of an amdgpu pp_dpm_sclk table ("0: 500Mhz\n1: 2615Mhz *\n")
+static float maxDpmClockMhz(const std::string &path)
+{
+	char text[1024];
+	if (!readSysfsText(path, text, sizeof(text)))
+		return 0.0f;
+	float best = 0.0f;
+	for (const char *line = text; line; )
+	{
+		if (const char *colon = std::strchr(line, ':'))
+			best = std::max(best, std::strtof(colon + 1, nullptr));
+		line = std::strchr(line, '\n');
+		if (line)
+			line++;
+	}
+	return best;
+}
+
+ThermalSampler::ThermalSampler(const std::string &root)
+{
+	findGpu(root);
+	findCpu(root);
+}
+
+void ThermalSampler::findGpu(const std::string &root)
+{
+	// The card with the most VRAM, like the VRAM monitor, which is the discrete GPU on hybrid systems
+	std::error_code ec;
+	bool found = false;
+	uint64_t bestVram = 0;
+	for (const fs::directory_entry &entry : fs::directory_iterator(sysfsPath(root, "/sys/class/drm"), ec))
+	{
+		std::string card = entry.path().filename().string();
+		if (card.compare(0, 4, "card") != 0 || card.size() == 4 ||
+			card.find_first_not_of("0123456789", 4) != std::string::npos)
+			continue;
+
+		std::string cardDir = entry.path().string() + "/";
+		std::string device = cardDir + "device/";
+		uint64_t vram = 0;
+		readSysfsUint64(device + "mem_info_vram_total", vram);
+		if (found && vram <= bestVram)
+			continue;
+
+		SysfsFile temp, clock, power;
+		float clockScale = 1.0f;
+		float maxClock = 0.0f;
+		float powerCap = 0.0f;
+		std::string hwmon = findHwmon(device + "hwmon");
+		if (!hwmon.empty())
+		{
+			// hwmon reports millidegrees, Hz and microwatts
+			temp.open(hwmon + findTemp(hwmon, {"edge", "junction"}));
+			if (clock.open(hwmon + "freq1_input"))
+			{
+				clockScale = 1e6f;
+				maxClock = maxDpmClockMhz(device + "pp_dpm_sclk");
+			}
+			if (!power.open(hwmon + "power1_average"))
+				power.open(hwmon + "power1_input");
+			uint64_t cap = 0;
+			if (readSysfsUint64(hwmon + "power1_cap", cap))
+				powerCap = cap / 1e6f;
+		}
+		// i915 has its clocks on the card, in MHz
+		uint64_t gtMax = 0;
+		if (!clock.isOpen() && clock.open(cardDir + "gt_act_freq_mhz") && readSysfsUint64(cardDir + "gt_max_freq_mhz", gtMax))
+			maxClock = float(gtMax);
+		if (!temp.isOpen() && !clock.isOpen() && !power.isOpen())
+			continue;
+
+		gpuTemp = std::move(temp);
+		gpuClock = std::move(clock);
+		gpuClockScale = clockScale;
+		gpuMaxClockMhz = maxClock;
+		gpuPower = std::move(power);
+		gpuPowerCapW = powerCap;
+		bestVram = vram;
+		found = true;
+	}
+}
+
+void ThermalSampler::findCpu(const std::string &root)
+{
+	// Drivers of CPU package sensors, and the labels of the package temperature
+	static const char *const drivers[] = {"k10temp", "zenpower", "coretemp", "cpu_thermal"};
+	std::error_code ec;
+	for (const fs::directory_entry &entry : fs::directory_iterator(sysfsPath(root, "/sys/class/hwmon"), ec))
+	{
+		std::string hwmon = entry.path().string() + "/";
+		char name[64];
+		if (!readSysfsText(hwmon + "name", name, sizeof(name)) ||
+			std::none_of(std::begin(drivers), std::end(drivers), [&](const char *driver)
+						 { return std::strcmp(name, driver) == 0; }))
+			continue;
+		if (cpuTemp.open(hwmon + findTemp(hwmon, {"Tdie", "Tctl", "Package id 0"})))
+			break;
+	}
+
+	// Current clock of every core, in kHz
+	for (const fs::directory_entry &entry : fs::directory_iterator(sysfsPath(root, "/sys/devices/system/cpu"), ec))
+	{
+		std::string cpu = entry.path().filename().string();
+		if (cpu.compare(0, 3, "cpu") != 0 || cpu.size() == 3 ||
+			cpu.find_first_not_of("0123456789", 3) != std::string::npos)
+			continue;
+
+		std::string cpufreq = entry.path().string() + "/cpufreq/";
+		SysfsFile file;
+		if (!file.open(cpufreq + "scaling_cur_freq"))
+			continue;
+		cpuClocks.push_back(std::move(file));
+		uint64_t maxKhz = 0;
+		if (readSysfsUint64(cpufreq + "cpuinfo_max_freq", maxKhz))
+			cpuMaxClockMhz = std::max(cpuMaxClockMhz, maxKhz / 1000.0f);
+	}
+}
+
+bool ThermalSampler::read(ThermalSample &sample) const
+{
+	sample = ThermalSample();
+	bool any = false;
+	uint64_t value = 0;
+	if (gpuTemp.readUint64(value))
+	{
+		sample.gpuTempC = value / 1000.0f;
+		any = true;
+	}
+	if (gpuClock.readUint64(value))
+	{
+		sample.gpuClockMhz = value / gpuClockScale;
+		any = true;
+	}
+	if (gpuPower.readUint64(value))
+	{
+		sample.gpuPowerW = value / 1e6f;
+		any = true;
+	}
+	if (cpuTemp.readUint64(value))
+	{
+		sample.cpuTempC = value / 1000.0f;
+		any = true;
+	}
+	for (const SysfsFile &file : cpuClocks)
+	{
+		if (!file.readUint64(value))
+			continue;
+		sample.cpuClockMhz = std::max(sample.cpuClockMhz, value / 1000.0f);
+		any = true;
+	}
+	sample.gpuMaxClockMhz = gpuMaxClockMhz;
+	sample.gpuPowerCapW = gpuPowerCapW;
+	sample.cpuMaxClockMhz = cpuMaxClockMhz;
+	return any;
+}
+
+// Appends to text, truncating once it's full
+template <typename... Args>
+static void append(char *text, size_t size, size_t &used, fmt::format_string<Args...> format, Args &&...args)
+{
+	auto result = fmt::format_to_n(text + used, size - 1 - used, format, std::forward<Args>(args)...);
+	used = std::min(size - 1, used + result.size);
+}
+
+void describeThermal(const ThermalSample &s, char *text, size_t size)
+{
+	if (size == 0)
+		return;
+	size_t used = 0;
+	if (s.gpuTempC > 0 || s.gpuClockMhz > 0 || s.gpuPowerW > 0)
+	{
+		append(text, size, used, "GPU");
+		if (s.gpuTempC > 0)
+			append(text, size, used, " {:.0f}C", s.gpuTempC);
+		if (s.gpuClockMhz > 0)
+			append(text, size, used, " {:.0f} MHz", s.gpuClockMhz);
+		if (s.gpuPowerW > 0)
+			append(text, size, used, " {:.0f} W", s.gpuPowerW);
+	}
+	if (s.cpuTempC > 0 || s.cpuClockMhz > 0)
+	{
+		append(text, size, used, "{}CPU", used > 0 ? ", " : "");
+		if (s.cpuTempC > 0)
+			append(text, size, used, " {:.0f}C", s.cpuTempC);
+		if (s.cpuClockMhz > 0)
+			append(text, size, used, " {:.1f} GHz", s.cpuClockMhz / 1000.0f);
+	}
+	if (used == 0)
+		append(text, size, used, "No sensors");
+	text[used] = '\0';
+}
+
+void describeThrottle(uint32_t reasons, char *text, size_t size)
+{
+	if (size == 0)
+		return;
+	size_t used = 0;
+	auto reason = [&](uint32_t bit, const char *name)
+	{
+		if (reasons & bit)
+			append(text, size, used, "{}{}", used > 0 ? ", " : "", name);
+	};
+
+	reason(throttleGpuTemp, "GPU temp");
+	reason(throttleCpuTemp, "CPU temp");
+	reason(throttleGpuPower, "GPU power cap");
+	reason(throttleGpuClock, "GPU clock");
+	if (used == 0)
+		append(text, size, used, "none");
+	text[used] = '\0';
+}
+
+bool ThrottleDetector::update(const ThrottleInput &input)
+{
+	const ThermalSample &s = input.sample;
+	// Once throttling, temperatures have to drop a bit further to count as cooled down
+	float coolDown = active ? coolDownC : 0.0f;
+
+	current = 0;
+	if (s.gpuTempC > 0 && input.gpuTempLimit > 0 && s.gpuTempC >= input.gpuTempLimit - coolDown)
+		current |= throttleGpuTemp;
+	if (s.cpuTempC > 0 && input.cpuTempLimit > 0 && s.cpuTempC >= input.cpuTempLimit - coolDown)
+		current |= throttleCpuTemp;
+	// A busy GPU well under its highest clock is held back, by its power cap if it's drawing all of it.
+	// Only once it stays there: coming out of a low power state, the clock lags behind the load.
+	bool lowClock = input.gpuBusy && s.gpuClockMhz > 0 && s.gpuClockMhz < s.gpuMaxClockMhz * input.clockRatio;
+	if (!lowClock)
+		lowClockSince = -1;
+	else if (lowClockSince < 0)
+		lowClockSince = input.timeMs;
+	if (lowClockSince >= 0 && input.timeMs - lowClockSince >= lowClockMs)
+	{
+		if (s.gpuPowerCapW > 0 && s.gpuPowerW >= s.gpuPowerCapW * powerCapShare)
+			current |= throttleGpuPower;
+		else
+			current |= throttleGpuClock;
+	}
+
+	if (current)
+	{
+		lastReasonMs = input.timeMs;
+		if (!active)
+		{
+			active = true;
+			since = input.timeMs;
+			eventCount++;
+		}
+	}
+	else if (active && input.timeMs - lastReasonMs >= input.releaseMs)
+	{
+		active = false;
+	}
+	return active;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sysfs.hpp"
+
+// One reading of the sensors, 0 where a sensor isn't available
+struct ThermalSample
+{
+	float gpuTempC = 0.0f;
+	float gpuClockMhz = 0.0f;
+	float gpuMaxClockMhz = 0.0f;
+	float gpuPowerW = 0.0f;
+	float gpuPowerCapW = 0.0f;
+	float cpuTempC = 0.0f;
+	// Fastest core, the game's main thread is likely on it
+	float cpuClockMhz = 0.0f;
+	float cpuMaxClockMhz = 0.0f;
+};
+
+// Short description for the window, e.g. "GPU 81C 2450 MHz 287 W, CPU 74C 4.6 GHz"
+void describeThermal(const ThermalSample &sample, char *text, size_t size);
+
+// GPU (amdgpu and i915 through hwmon and DRM sysfs) and CPU (k10temp, zenpower,
+// coretemp and cpufreq) sensors. Files are opened once, a read is a pread per sensor.
+// Every path is looked up under root, so a fake directory tree can stand in for the real one.
+class ThermalSampler
+{
+public:
+	explicit ThermalSampler(const std::string &root);
+
+	// Whether any sensor was found
+	bool valid() const { return gpuTemp.isOpen() || gpuClock.isOpen() || gpuPower.isOpen() || cpuTemp.isOpen() || !cpuClocks.empty(); }
+
+	// False if no sensor could be read
+	bool read(ThermalSample &sample) const;
+
+private:
+	void findGpu(const std::string &root);
+	void findCpu(const std::string &root);
+
+	SysfsFile gpuTemp;
+	SysfsFile gpuClock;
+	// Units of gpuClock per MHz (Hz for hwmon, MHz for i915)
+	float gpuClockScale = 1.0f;
+	float gpuMaxClockMhz = 0.0f;
+	SysfsFile gpuPower;
+	float gpuPowerCapW = 0.0f;
+
+	SysfsFile cpuTemp;
+	std::vector<SysfsFile> cpuClocks;
+	float cpuMaxClockMhz = 0.0f;
+};
+
+// Bits of why the hardware counts as throttling
+static constexpr uint32_t throttleGpuTemp = 0x01;
+static constexpr uint32_t throttleCpuTemp = 0x02;
+static constexpr uint32_t throttleGpuPower = 0x04;
+static constexpr uint32_t throttleGpuClock = 0x08;
+
+// Short description for the window, e.g. "GPU temp, GPU clock"
+void describeThrottle(uint32_t reasons, char *text, size_t size);
+
+// What throttling is detected from, once per tick
+struct ThrottleInput
+{
+	long timeMs = 0;
+	ThermalSample sample;
+	// Frames keep the GPU busy, so its clock should be boosting
+	bool gpuBusy = false;
+
+	float gpuTempLimit = 90.0f;
+	float cpuTempLimit = 90.0f;
+	// Share of the highest GPU clock under which a busy GPU counts as held back
+	float clockRatio = 0.8f;
+	// How long every reason has to be gone before throttling counts as over
+	long releaseMs = 10000;
+};
+
+// Recognizes thermal and power throttling from the sensors: a temperature at
+// its limit, or a busy GPU clocked well under its highest clock for
+// lowClockMs on every tick (blamed on the power cap when it's drawing
+// all of it). Once throttling, temperatures have to cool down by coolDownC
+// and every reason has to stay gone for releaseMs before it's over, the
+// hardware heats right back up otherwise.
+class ThrottleDetector
+{
+public:
+	static constexpr float coolDownC = 5.0f;
+	// Share of the power cap that counts as drawing it
+	static constexpr float powerCapShare = 0.97f;
+	// How long a busy GPU has to stay under the clock ratio, whatever the poll delay
+	static constexpr long lowClockMs = 1000;
+
+	// Returns whether the hardware is throttling from now on
+	bool update(const ThrottleInput &input);
+
+	bool throttling() const { return active; }
+	// Reasons of the latest tick
+	uint32_t reasons() const { return current; }
+	// When throttling last started
+	long enteredMs() const { return since; }
+	uint64_t events() const { return eventCount; }
+
+private:
+	uint32_t current = 0;
+	// When the busy GPU went under the clock ratio, -1 when it isn't
+	long lowClockSince = -1;
+	bool active = false;
+	long since = 0;
+	long lastReasonMs = 0;
+	uint64_t eventCount = 0;
+};
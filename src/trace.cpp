@@ -0,0 +1,212 @@
+#include "trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// How often the writer thread wakes up to flush queued records
+static constexpr auto writerInterval = std::chrono::milliseconds(50);
+
+TraceRecorder::TraceRecorder()
+	: queue(new Entry[queueCapacity])
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+	close();
+}
+
+// Whether records of this build can go after what the file holds
+static bool appendable(const std::string &path)
+{
+	FILE *in = fopen(path.c_str(), "rb");
+	if (!in)
+		return true;
+	TraceHeader header;
+	bool matches = fread(&header, sizeof(header), 1, in) == 1 && memcmp(header.magic, traceMagic, sizeof(traceMagic)) == 0 &&
+				   header.frameSize == sizeof(FrameSample) && header.tickSize == sizeof(TraceTick);
+	// An empty file just gets the header
+	bool empty = !matches && fseek(in, 0, SEEK_END) == 0 && ftell(in) == 0;
+	fclose(in);
+	return matches || empty;
+}
+
+bool TraceRecorder::open(const std::string &path)
+{
+	close();
+
+	// Appending to a file of another build would make all of it unreadable, keep it aside instead
+	if (!appendable(path))
+	{
+		std::string old = path + ".old";
+		remove(old.c_str());
+		if (rename(path.c_str(), old.c_str()) != 0)
+			return false;
+	}
+
+	file = fopen(path.c_str(), "ab");
+	if (!file)
+		return false;
+	setvbuf(file, nullptr, _IOFBF, 1 << 16);
+
+	// New file, write the header first
+	fseek(file, 0, SEEK_END);
+	if (ftell(file) == 0)
+	{
+		TraceHeader header;
+		memcpy(header.magic, traceMagic, sizeof(header.magic));
+		header.frameSize = sizeof(FrameSample);
+		header.tickSize = sizeof(TraceTick);
+		fwrite(&header, sizeof(header), 1, file);
+	}
+
+	running = true;
+	writer = std::thread(&TraceRecorder::writerLoop, this);
+	return true;
+}
+
+void TraceRecorder::close()
+{
+	if (!file)
+		return;
+
+	running = false;
+	if (writer.joinable())
+		writer.join();
+
+	drain();
+	fclose(file);
+	file = nullptr;
+}
+
+bool TraceRecorder::push(const Entry &entry)
+{
+	if (!file)
+		return false;
+
+	size_t h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) >= queueCapacity)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	queue[h % queueCapacity] = entry;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+void TraceRecorder::recordFrame(const FrameSample &frame)
+{
+	Entry entry;
+	entry.type = TraceRecord_Frame;
+	entry.frame = frame;
+	push(entry);
+}
+
+void TraceRecorder::recordTick(const TraceTick &tick)
+{
+	Entry entry;
+	entry.type = TraceRecord_Tick;
+	entry.tick = tick;
+	push(entry);
+}
+
+void TraceRecorder::drain()
+{
+	size_t t = tail.load(std::memory_order_relaxed);
+	size_t h = head.load(std::memory_order_acquire);
+	for (; t != h; t++)
+	{
+		const Entry &entry = queue[t % queueCapacity];
+		fwrite(&entry.type, sizeof(entry.type), 1, file);
+		if (entry.type == TraceRecord_Frame)
+			fwrite(&entry.frame, sizeof(entry.frame), 1, file);
+		else
+			fwrite(&entry.tick, sizeof(entry.tick), 1, file);
+	}
+	tail.store(t, std::memory_order_release);
+	fflush(file);
+}
+
+void TraceRecorder::writerLoop()
+{
+	while (running)
+	{
+		std::this_thread::sleep_for(writerInterval);
+		drain();
+	}
+}
+
+bool isBinaryTrace(const std::string &path)
+{
+	FILE *in = fopen(path.c_str(), "rb");
+	if (!in)
+		return false;
+	char magic[sizeof(traceMagic)];
+	bool matches = fread(magic, sizeof(magic), 1, in) == 1 && memcmp(magic, traceMagic, sizeof(magic)) == 0;
+	fclose(in);
+	return matches;
+}
+
+bool readTrace(const std::string &path, std::vector<TraceFrame> &frames, std::vector<TraceTick> &ticks, std::string &error)
+{
+	FILE *in = fopen(path.c_str(), "rb");
+	if (!in)
+	{
+		error = "Could not open " + path;
+		return false;
+	}
+
+	TraceHeader header;
+	if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, traceMagic, sizeof(traceMagic)) != 0)
+	{
+		error = path + " is not a trace file";
+		fclose(in);
+		return false;
+	}
+	if (header.frameSize != sizeof(FrameSample) || header.tickSize != sizeof(TraceTick))
+	{
+		error = path + " was recorded by an incompatible build";
+		fclose(in);
+		return false;
+	}
+
+	float res = 0.0f;
+	double firstFrameSeconds = -1.0;
+	uint8_t type;
+	while (fread(&type, sizeof(type), 1, in) == 1)
+	{
+		if (type == TraceRecord_Frame)
+		{
+			TraceFrame trace;
+			if (fread(&trace.frame, sizeof(trace.frame), 1, in) != 1)
+				break;
+			if (firstFrameSeconds < 0)
+				firstFrameSeconds = trace.frame.systemTimeInSeconds;
+			trace.timeMs = (trace.frame.systemTimeInSeconds - firstFrameSeconds) * 1000.0;
+			trace.res = res;
+			frames.push_back(trace);
+		}
+		else if (type == TraceRecord_Tick)
+		{
+			TraceTick tick;
+			if (fread(&tick, sizeof(tick), 1, in) != 1)
+				break;
+			// Frames recorded after this tick were rendered at the resolution it set
+			res = tick.newRes;
+			ticks.push_back(tick);
+		}
+		else
+		{
+			error = path + " is corrupted";
+			fclose(in);
+			return false;
+		}
+	}
+
+	// A partial record at the end just means the recording was cut short
+	fclose(in);
+	return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "controller.hpp"
+#include "tracecsv.hpp"
+
+// Binary trace file layout:
+//   TraceHeader, then records made of a one byte TraceRecordType followed by
+//   the raw FrameSample or TraceTick. Files are only ever appended to and are
+//   meant to be decoded on the same platform they were recorded on.
+static constexpr char traceMagic[8] = {'O', 'V', 'D', 'R', 'T', 'R', 'C', '1'};
+
+struct TraceHeader
+{
+	char magic[8];
+	uint32_t frameSize;
+	uint32_t tickSize;
+};
+
+enum TraceRecordType : uint8_t
+{
+	TraceRecord_Frame = 1,
+	TraceRecord_Tick = 2,
+};
+
+// What the controller computed and decided on one tick
+struct TraceTick
+{
+	int64_t timeMs = 0;
+	float currentRes = 0.0f;
+	float newRes = 0.0f;
+	float averageGpuTime = 0.0f;
+	float averageCpuTime = 0.0f;
+	float targetFrametime = 0.0f;
+	uint32_t action = 0;
+};
+
+// Records frames and ticks to a binary trace file.
+// The record calls only copy into a lock-free queue; a background thread does
+// the file writes, so recording never blocks the sampling loop. Records that
+// don't fit in the queue are dropped and counted.
+class TraceRecorder
+{
+public:
+	static constexpr size_t queueCapacity = 8192;
+
+	TraceRecorder();
+	~TraceRecorder();
+
+	// Opens (or appends to) the trace file and starts the writer thread
+	bool open(const std::string &path);
+	void close();
+	bool isOpen() const { return file != nullptr; }
+
+	void recordFrame(const FrameSample &frame);
+	void recordTick(const TraceTick &tick);
+
+	uint64_t droppedRecords() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	struct Entry
+	{
+		TraceRecordType type;
+		FrameSample frame;
+		TraceTick tick;
+	};
+
+	bool push(const Entry &entry);
+	void writerLoop();
+	void drain();
+
+	FILE *file = nullptr;
+	std::unique_ptr<Entry[]> queue;
+	std::atomic<size_t> head{0}; // written by the sampling loop
+	std::atomic<size_t> tail{0}; // written by the writer thread
+	std::atomic<bool> running{false};
+	std::atomic<uint64_t> dropped{0};
+	std::thread writer;
+};
+
+// Reads a whole binary trace. Frames get the resolution in effect when they were
+// recorded and a timeMs relative to the first frame, so they can be replayed.
+bool readTrace(const std::string &path, std::vector<TraceFrame> &frames, std::vector<TraceTick> &ticks, std::string &error);
+
+// Whether the file at path starts with the binary trace header
+bool isBinaryTrace(const std::string &path);
@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <iostream>
+#include <fmt/core.h>
+#include <args.hxx>
+
+#include "controller.hpp"
+#include "trace.hpp"
+#include "tracecsv.hpp"
+
+int main(int argc, char *argv[])
+{
+	args::ArgumentParser parser("Converts a binary trace recorded with traceFile to CSV.",
+								"The frames CSV can be fed back to replay with --trace.");
+	args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
+	args::Positional<std::string> tracePath(parser, "trace", "Binary trace file");
+	args::ValueFlag<std::string> framesPath(parser, "file", "Write frames here instead of stdout", {'f', "frames"});
+	args::ValueFlag<std::string> ticksPath(parser, "file", "Also write the controller ticks here", {'t', "ticks"});
+
+	try
+	{
+		parser.ParseCLI(argc, argv);
+	}
+	catch (const args::Help &)
+	{
+		std::cout << parser;
+		return 0;
+	}
+	catch (const args::Error &e)
+	{
+		std::cerr << e.what() << std::endl
+				  << parser;
+		return 1;
+	}
+	if (!tracePath)
+	{
+		std::cerr << parser;
+		return 1;
+	}
+
+	std::vector<TraceFrame> frames;
+	std::vector<TraceTick> ticks;
+	std::string error;
+	if (!readTrace(args::get(tracePath), frames, ticks, error))
+	{
+		fmt::print(stderr, "{}\n", error);
+		return 1;
+	}
+
+	FILE *out = stdout;
+	if (framesPath)
+	{
+		out = fopen(args::get(framesPath).c_str(), "w");
+		if (!out)
+		{
+			fmt::print(stderr, "Could not open {}\n", args::get(framesPath));
+			return 1;
+		}
+	}
+	writeCsvHeader(out);
+	for (const TraceFrame &frame : frames)
+		writeCsvRow(out, frame);
+	if (out != stdout)
+		fclose(out);
+
+	if (ticksPath)
+	{
+		out = fopen(args::get(ticksPath).c_str(), "w");
+		if (!out)
+		{
+			fmt::print(stderr, "Could not open {}\n", args::get(ticksPath));
+			return 1;
+		}
+		fmt::print(out, "timeMs,currentRes,newRes,averageGpuTime,averageCpuTime,targetFrametime,action\n");
+		for (const TraceTick &tick : ticks)
+		{
+			fmt::print(out, "{},{},{},{},{},{},{}\n", tick.timeMs, tick.currentRes, tick.newRes, tick.averageGpuTime,
+					   tick.averageCpuTime, tick.targetFrametime, actionName(Action(tick.action)));
+		}
+		fclose(out);
+	}
+
+	fmt::print(stderr, "{} frames, {} ticks\n", frames.size(), ticks.size());
+	return 0;
+}
@@ -0,0 +1,167 @@
+#include "tracecsv.hpp"
+
+#include <fstream>
+#include <fmt/core.h>
+#include <sstream>
+
+#define FRAME_FIELD(member)                                                    \
+	{                                                                          \
+		#member,                                                               \
+			[](const FrameSample &f) { return double(f.member); },             \
+			[](FrameSample &f, double v) { f.member = decltype(f.member)(v); } \
+	}
+
+const FrameField frameFields[] = {
+	FRAME_FIELD(frameIndex),
+	FRAME_FIELD(numFramePresents),
+	FRAME_FIELD(numMisPresented),
+	FRAME_FIELD(numDroppedFrames),
+	FRAME_FIELD(reprojectionFlags),
+	FRAME_FIELD(systemTimeInSeconds),
+	FRAME_FIELD(preSubmitGpuMs),
+	FRAME_FIELD(postSubmitGpuMs),
+	FRAME_FIELD(totalRenderGpuMs),
+	FRAME_FIELD(compositorRenderGpuMs),
+	FRAME_FIELD(compositorRenderCpuMs),
+	FRAME_FIELD(compositorIdleCpuMs),
+	FRAME_FIELD(clientFrameIntervalMs),
+	FRAME_FIELD(presentCallCpuMs),
+	FRAME_FIELD(waitForPresentCpuMs),
+	FRAME_FIELD(submitFrameMs),
+	FRAME_FIELD(waitGetPosesCalledMs),
+	FRAME_FIELD(newPosesReadyMs),
+	FRAME_FIELD(newFrameReadyMs),
+	FRAME_FIELD(compositorUpdateStartMs),
+	FRAME_FIELD(compositorUpdateEndMs),
+	FRAME_FIELD(compositorRenderStartMs),
+	FRAME_FIELD(numVSyncsReadyForUse),
+	FRAME_FIELD(numVSyncsToFirstView),
+};
+
+const size_t frameFieldCount = sizeof(frameFields) / sizeof(frameFields[0]);
+
+// Special columns on top of the FrameSample members
+enum Column
+{
+	Column_Ignored = -1,
+	Column_TimeMs = -2,
+	Column_Res = -3,
+	Column_GpuMs = -4,
+	Column_CpuMs = -5,
+};
+
+static int columnOf(const std::string &name)
+{
+	if (name == "timeMs")
+		return Column_TimeMs;
+	if (name == "res")
+		return Column_Res;
+	if (name == "gpuMs")
+		return Column_GpuMs;
+	if (name == "cpuMs")
+		return Column_CpuMs;
+	for (size_t i = 0; i < frameFieldCount; i++)
+	{
+		if (name == frameFields[i].name)
+			return int(i);
+	}
+	return Column_Ignored;
+}
+
+static std::string trim(const std::string &s)
+{
+	size_t begin = s.find_first_not_of(" \t\r");
+	if (begin == std::string::npos)
+		return "";
+	size_t end = s.find_last_not_of(" \t\r");
+	return s.substr(begin, end - begin + 1);
+}
+
+bool readCsvTrace(const std::string &path, std::vector<TraceFrame> &frames, std::string &error)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "Could not open " + path;
+		return false;
+	}
+
+	// Map the header to columns
+	std::string line;
+	if (!std::getline(file, line))
+	{
+		error = path + " is empty";
+		return false;
+	}
+	std::vector<int> columns;
+	std::stringstream header(line);
+	std::string cell;
+	while (std::getline(header, cell, ','))
+		columns.push_back(columnOf(trim(cell)));
+
+	size_t lineNumber = 1;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		if (trim(line).empty())
+			continue;
+
+		TraceFrame trace;
+		std::stringstream row(line);
+		for (size_t i = 0; i < columns.size() && std::getline(row, cell, ','); i++)
+		{
+			if (columns[i] == Column_Ignored)
+				continue;
+
+			double value;
+			try
+			{
+				value = std::stod(cell);
+			}
+			catch (const std::exception &)
+			{
+				error = path + ":" + std::to_string(lineNumber) + ": invalid number '" + trim(cell) + "'";
+				return false;
+			}
+
+			switch (columns[i])
+			{
+			case Column_TimeMs:
+				trace.timeMs = value;
+				break;
+			case Column_Res:
+				trace.res = float(value);
+				break;
+			case Column_GpuMs:
+				trace.frame.totalRenderGpuMs = float(value);
+				break;
+			case Column_CpuMs:
+				trace.frame.newPosesReadyMs = 0.0f;
+				trace.frame.newFrameReadyMs = float(value);
+				break;
+			default:
+				frameFields[columns[i]].set(trace.frame, value);
+				break;
+			}
+		}
+		frames.push_back(trace);
+	}
+
+	return true;
+}
+
+void writeCsvHeader(FILE *out)
+{
+	fmt::print(out, "timeMs,res");
+	for (size_t i = 0; i < frameFieldCount; i++)
+		fmt::print(out, ",{}", frameFields[i].name);
+	fmt::print(out, "\n");
+}
+
+void writeCsvRow(FILE *out, const TraceFrame &trace)
+{
+	fmt::print(out, "{:.3f},{}", trace.timeMs, trace.res);
+	for (size_t i = 0; i < frameFieldCount; i++)
+		fmt::print(out, ",{}", frameFields[i].get(trace.frame));
+	fmt::print(out, "\n");
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "controller.hpp"
+
+// A FrameSample member, addressable by name for CSV import/export
+struct FrameField
+{
+	const char *name;
+	double (*get)(const FrameSample &frame);
+	void (*set)(FrameSample &frame, double value);
+};
+
+extern const FrameField frameFields[];
+extern const size_t frameFieldCount;
+
+// One frame of a recorded or hand-written trace
+struct TraceFrame
+{
+	// Time the frame was presented (-1 if the trace doesn't say)
+	double timeMs = -1.0;
+	// Supersample scale the frame was rendered at (0 if the trace doesn't say)
+	float res = 0.0f;
+	FrameSample frame;
+};
+
+// Reads a CSV trace with a header row. Columns are matched by name:
+// timeMs, res, gpuMs (shorthand for totalRenderGpuMs), cpuMs (application CPU time)
+// and any FrameSample member name (frameIndex, totalRenderGpuMs, numFramePresents...).
+// Unknown columns are ignored.
+bool readCsvTrace(const std::string &path, std::vector<TraceFrame> &frames, std::string &error);
+
+// Writes frames in the format readCsvTrace() expects
+void writeCsvHeader(FILE *out);
+void writeCsvRow(FILE *out, const TraceFrame &trace);
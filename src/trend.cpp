@@ -0,0 +1,69 @@
+#include "trend.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Weight of each frame in the frame interval and the noise
+static constexpr double intervalSmoothing = 1.0 / 64;
+static constexpr double noiseSmoothing = 1.0 / 128;
+// Errors beyond this many standard deviations are clipped, so that single spikes don't read as a trend
+static constexpr double outlierDeviations = 3.0;
+
+void TrendPredictor::add(double timeS, float ms)
+{
+	if (samples == 0)
+	{
+		lvl = ms;
+		slope = 0.0;
+		variance = 0.0;
+		interval = 0.0;
+	}
+	else
+	{
+		double dt = timeS - lastTimeS;
+		if (dt > 0)
+			interval = interval > 0 ? interval + (dt - interval) * intervalSmoothing : dt;
+
+		double predicted = lvl + slope;
+		double error = ms - predicted;
+		variance += (error * error - variance) * noiseSmoothing;
+		if (samples >= minSamples)
+		{
+			double limit = outlierDeviations * std::sqrt(variance);
+			error = std::clamp(error, -limit, limit);
+		}
+
+		double previous = lvl;
+		lvl = predicted + levelSmoothing * error;
+		slope += slopeSmoothing * (lvl - previous - slope);
+	}
+	lastTimeS = timeS;
+	if (samples < minSamples)
+		samples++;
+}
+
+void TrendPredictor::clear()
+{
+	samples = 0;
+}
+
+float TrendPredictor::slopePerSecond() const
+{
+	return interval > 0 ? float(slope / interval) : 0.0f;
+}
+
+float TrendPredictor::noise() const
+{
+	return float(std::sqrt(variance));
+}
+
+float TrendPredictor::project(float horizonMs) const
+{
+	return float(lvl + slopePerSecond() * horizonMs / 1000.0);
+}
+
+bool TrendPredictor::rising(float horizonMs) const
+{
+	float rise = slopePerSecond() * horizonMs / 1000.0f;
+	return ready() && rise > 0 && rise > noise();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Level, slope and noise of a frametime series, with Holt's double
+// exponential smoothing over the frames. Used to see a rising GPU frametime
+// coming before the averages cross a threshold.
+class TrendPredictor
+{
+public:
+	// Smoothing of the level (~32 frames) and of the slope (~128 frames)
+	static constexpr double levelSmoothing = 2.0 / 33;
+	static constexpr double slopeSmoothing = 2.0 / 129;
+	// Frames before the slope is trusted
+	static constexpr uint32_t minSamples = 128;
+
+	void add(double timeS, float ms);
+	void clear();
+
+	bool ready() const { return samples >= minSamples; }
+
+	float level() const { return float(lvl); }
+	// Change of the frametime per second
+	float slopePerSecond() const;
+	// Standard deviation of the frames around the level
+	float noise() const;
+
+	// Frametime expected horizonMs from now
+	float project(float horizonMs) const;
+	// Whether the frametime rises by more than its noise over horizonMs
+	bool rising(float horizonMs) const;
+
+private:
+	double lvl = 0.0;
+	double slope = 0.0; // per frame
+	double variance = 0.0;
+	// Seconds between frames
+	double interval = 0.0;
+	double lastTimeS = 0.0;
+	uint32_t samples = 0;
+};
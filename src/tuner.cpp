@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <fmt/core.h>
+#include <args.hxx>
+
+#include "closedloop.hpp"
+#include "settings.hpp"
+
+// One searched value of ControllerConfig, between min and max in multiples of step
+struct Parameter
+{
+	const char *name;
+	double min;
+	double max;
+	double step;
+	// Written as a percentage in settings.ini
+	bool percent;
+	double (*get)(const ControllerConfig &c);
+	void (*set)(ControllerConfig &c, double value);
+};
+
+// The gains and thresholds of the controller. minRes and maxRes are left alone,
+// they're up to the user's hardware and taste.
+static const Parameter parameters[] = {
+	{"resIncreaseThreshold", 0.50, 0.90, 0.01, true,
+	 [](const ControllerConfig &c) { return double(c.resIncreaseThreshold); },
+	 [](ControllerConfig &c, double v) { c.resIncreaseThreshold = float(v); }},
+	{"resDecreaseThreshold", 0.60, 0.98, 0.01, true,
+	 [](const ControllerConfig &c) { return double(c.resDecreaseThreshold); },
+	 [](ControllerConfig &c, double v) { c.resDecreaseThreshold = float(v); }},
+	{"resIncreaseScale", 0.10, 1.50, 0.01, true,
+	 [](const ControllerConfig &c) { return double(c.resIncreaseScale); },
+	 [](ControllerConfig &c, double v) { c.resIncreaseScale = float(v); }},
+	{"resDecreaseScale", 0.20, 2.00, 0.01, true,
+	 [](const ControllerConfig &c) { return double(c.resDecreaseScale); },
+	 [](ControllerConfig &c, double v) { c.resDecreaseScale = float(v); }},
+	{"resIncreaseMin", 0.00, 0.25, 0.01, true,
+	 [](const ControllerConfig &c) { return double(c.resIncreaseMin); },
+	 [](ControllerConfig &c, double v) { c.resIncreaseMin = float(v); }},
+	{"resDecreaseMin", 0.01, 0.20, 0.01, true,
+	 [](const ControllerConfig &c) { return double(c.resDecreaseMin); },
+	 [](ControllerConfig &c, double v) { c.resDecreaseMin = float(v); }},
+	{"resChangeDelayMs", 100, 4000, 50, false,
+	 [](const ControllerConfig &c) { return double(c.resChangeDelayMs); },
+	 [](ControllerConfig &c, double v) { c.resChangeDelayMs = long(v); }},
+	{"dataPullDelayMs", 50, 500, 10, false,
+	 [](const ControllerConfig &c) { return double(c.dataPullDelayMs); },
+	 [](ControllerConfig &c, double v) { c.dataPullDelayMs = long(v); }},
+	{"dataAverageSamples", 16, 512, 8, false,
+	 [](const ControllerConfig &c) { return double(c.dataAverageSamples); },
+	 [](ControllerConfig &c, double v) { c.dataAverageSamples = int(v); }},
+	{"hitchCostWeight", 0.00, 0.50, 0.01, true,
+	 [](const ControllerConfig &c) { return double(c.hitchCostWeight); },
+	 [](ControllerConfig &c, double v) { c.hitchCostWeight = float(v); }},
+	{"predictiveDecrease", 0, 1, 1, false,
+	 [](const ControllerConfig &c) { return double(c.predictiveDecrease); },
+	 [](ControllerConfig &c, double v) { c.predictiveDecrease = int(v); }},
+	{"controllerMode", 0, 1, 1, false,
+	 [](const ControllerConfig &c) { return double(c.controllerMode); },
+	 [](ControllerConfig &c, double v) { c.controllerMode = int(v); }},
+};
+
+static constexpr size_t parameterCount = std::size(parameters);
+// Smallest gap between the increase and decrease thresholds, so that they don't fight each other
+static constexpr double minThresholdGap = 0.02;
+// Best candidates the next round searches around
+static constexpr size_t eliteCount = 8;
+
+// What a run costs: lower is better
+struct Weights
+{
+	// Per unit of average resolution (1 = 100%), counted against the cost
+	double res = 1.0;
+	// Per unit of the ratio of missed frames
+	double missed = 10.0;
+	// Per resolution change per minute
+	double changes = 0.01;
+};
+
+struct Candidate
+{
+	std::array<double, parameterCount> values{};
+	Settings settings;
+	bool baseline = false;
+	bool valid = false;
+
+	// Means over every scenario and seed
+	double cost = 0.0;
+	double averageRes = 0.0;
+	double missedFrameRatio = 0.0;
+	double changesPerMinute = 0.0;
+};
+
+// Snaps the values to their steps and ranges, keeps them consistent with each other, and builds the settings
+static Candidate makeCandidate(const Settings &base, std::array<double, parameterCount> values)
+{
+	Candidate candidate;
+	candidate.settings = base;
+	ControllerConfig &c = candidate.settings.controller;
+	for (size_t i = 0; i < parameterCount; i++)
+	{
+		const Parameter &p = parameters[i];
+		values[i] = std::clamp(std::round(values[i] / p.step) * p.step, p.min, p.max);
+		p.set(c, values[i]);
+	}
+	c.resDecreaseThreshold = std::min(std::max(c.resDecreaseThreshold, c.resIncreaseThreshold + float(minThresholdGap)), 1.0f);
+	c.dataAverageSamples = std::min(c.dataAverageSamples, c.dataWindowSamples);
+	for (size_t i = 0; i < parameterCount; i++)
+		values[i] = parameters[i].get(c);
+
+	std::string error;
+	candidate.values = values;
+	candidate.valid = validateSettings(candidate.settings, error);
+	return candidate;
+}
+
+static void evaluate(Candidate &candidate, const std::vector<SimConfig> &runs, double durationS, const Weights &weights)
+{
+	if (!candidate.valid)
+		return;
+	for (const SimConfig &sim : runs)
+	{
+		ClosedLoopResult result = runClosedLoop(candidate.settings.controller, sim, durationS);
+		candidate.averageRes += result.averageRes;
+		candidate.missedFrameRatio += result.missedFrameRatio;
+		candidate.changesPerMinute += result.changes / (durationS / 60.0);
+	}
+	candidate.averageRes /= runs.size();
+	candidate.missedFrameRatio /= runs.size();
+	candidate.changesPerMinute /= runs.size();
+	candidate.cost = weights.missed * candidate.missedFrameRatio + weights.changes * candidate.changesPerMinute - weights.res * candidate.averageRes;
+}
+
+// Evaluates candidates from first on, on every core
+static void evaluateAll(std::vector<Candidate> &candidates, size_t first, unsigned jobs,
+						const std::vector<SimConfig> &runs, double durationS, const Weights &weights)
+{
+	std::atomic<size_t> next{first};
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < jobs; i++)
+	{
+		workers.emplace_back([&]
+							 {
+			for (size_t j = next++; j < candidates.size(); j = next++)
+				evaluate(candidates[j], runs, durationS, weights); });
+	}
+	for (std::thread &worker : workers)
+		worker.join();
+}
+
+// Invalid candidates last, then by cost. Sorts are stable, so the ranking doesn't depend on the number of threads.
+static bool better(const Candidate &a, const Candidate &b)
+{
+	if (a.valid != b.valid)
+		return a.valid;
+	return a.cost < b.cost;
+}
+
+static std::string formatValue(const Parameter &p, double value)
+{
+	return p.percent ? fmt::format("{:g}", std::round(value * 10000.0) / 100.0) : fmt::format("{:g}", value);
+}
+
+int main(int argc, char *argv[])
+{
+	args::ArgumentParser parser("Searches the controller parameters of settings.ini against the simulated compositor, on every core.",
+								"Prints the ranked candidates as CSV and writes the best one as a settings file. "
+								"The cost of a candidate is missed-weight * missed frame ratio + change-weight * changes per minute "
+								"- res-weight * average resolution, averaged over the scenarios and seeds.");
+	args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
+	args::ValueFlag<std::string> settingsPath(parser, "file", "Settings file to start from, its other values are kept", {'s', "settings"}, "settings.ini");
+	args::ValueFlag<std::string> output(parser, "file", "Where to write the best settings", {'o', "output"}, "settings.tuned.ini");
+	args::ValueFlag<std::string> scenario(parser, "name", "Only tune for this scenario (steady, bursty, scene-change, ramp, manual-step, cpu-bound; all but cpu-bound by default)", {"scenario"});
+	args::ValueFlag<float> hz(parser, "hz", "Simulated HMD refresh rate", {"hz"}, 90.0f);
+	args::ValueFlag<double> duration(parser, "seconds", "Simulated time per scenario", {"duration"}, 120.0);
+	args::ValueFlag<unsigned> seeds(parser, "count", "Runs of each scenario with a different random seed", {"seeds"}, 2);
+	args::ValueFlag<unsigned> candidates(parser, "count", "Candidates evaluated per round", {"candidates"}, 128);
+	args::ValueFlag<unsigned> rounds(parser, "count", "Rounds of the search: random at first, then closer and closer to the best candidates", {"rounds"}, 4);
+	args::ValueFlag<unsigned> jobs(parser, "count", "Threads (0 = one per core)", {'j', "jobs"}, 0);
+	args::ValueFlag<unsigned> seed(parser, "seed", "Random seed of the search", {"seed"}, 1);
+	args::ValueFlag<unsigned> top(parser, "count", "Candidates printed", {"top"}, 10);
+	args::ValueFlag<double> resWeight(parser, "weight", "Weight of the average resolution (1 = 100%)", {"res-weight"}, Weights().res);
+	args::ValueFlag<double> missedWeight(parser, "weight", "Weight of the ratio of missed frames", {"missed-weight"}, Weights().missed);
+	args::ValueFlag<double> changeWeight(parser, "weight", "Weight of the resolution changes per minute", {"change-weight"}, Weights().changes);
+
+	try
+	{
+		parser.ParseCLI(argc, argv);
+	}
+	catch (const args::Help &)
+	{
+		std::cout << parser;
+		return 0;
+	}
+	catch (const args::Error &e)
+	{
+		std::cerr << e.what() << std::endl
+				  << parser;
+		return 1;
+	}
+
+	// The output keeps the layout and the other values of the base file
+	std::string baseText;
+	{
+		std::ifstream file(args::get(settingsPath), std::ios::binary);
+		std::ostringstream text;
+		text << file.rdbuf();
+		baseText = text.str();
+	}
+	Settings base;
+	std::string error;
+	if (!parseSettings(baseText, base, &error) || !validateSettings(base, error))
+	{
+		fmt::print(stderr, "Could not load {} ({}), starting from the defaults\n", args::get(settingsPath), error);
+		base = Settings();
+	}
+
+	// Resolution can't help with cpu-bound: it adds the same missed frames to every
+	// candidate and only blurs the differences, so it's only tuned for on request
+	std::vector<std::string> names;
+	for (const std::string &name : simScenarioNames())
+	{
+		if (name != "cpu-bound")
+			names.push_back(name);
+	}
+	if (scenario)
+		names = {args::get(scenario)};
+	std::vector<SimConfig> runs;
+	for (const std::string &name : names)
+	{
+		SimConfig sim;
+		if (!simScenario(name, args::get(hz), sim))
+		{
+			fmt::print(stderr, "Unknown scenario {}\n", name);
+			return 1;
+		}
+		for (unsigned i = 1; i <= std::max(args::get(seeds), 1u); i++)
+		{
+			sim.seed = i;
+			runs.push_back(sim);
+		}
+	}
+
+	Weights weights;
+	weights.res = args::get(resWeight);
+	weights.missed = args::get(missedWeight);
+	weights.changes = args::get(changeWeight);
+	unsigned threads = args::get(jobs) > 0 ? args::get(jobs) : std::max(std::thread::hardware_concurrency(), 1u);
+	size_t perRound = std::max(args::get(candidates), 1u);
+	double durationS = args::get(duration);
+
+	// The first round samples the whole space, starting with the base file itself
+	std::mt19937 rng(args::get(seed));
+	std::vector<Candidate> all;
+	Candidate baseline;
+	baseline.settings = base;
+	baseline.baseline = true;
+	baseline.valid = true;
+	for (size_t i = 0; i < parameterCount; i++)
+		baseline.values[i] = parameters[i].get(base.controller);
+	all.push_back(baseline);
+	while (all.size() < perRound)
+	{
+		std::array<double, parameterCount> values;
+		for (size_t i = 0; i < parameterCount; i++)
+			values[i] = std::uniform_real_distribution<double>(parameters[i].min, parameters[i].max + parameters[i].step * 0.5)(rng);
+		all.push_back(makeCandidate(base, values));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	size_t evaluated = 0;
+	for (unsigned round = 0; round < std::max(args::get(rounds), 1u); round++)
+	{
+		// Later rounds move the best candidates by less and less
+		if (round > 0)
+		{
+			std::stable_sort(all.begin(), all.end(), better);
+			size_t elites = std::min(eliteCount, all.size());
+			double spread = std::ldexp(0.25, -int(round - 1));
+			for (size_t i = 0; i < perRound; i++)
+			{
+				std::array<double, parameterCount> values = all[i % elites].values;
+				for (size_t j = 0; j < parameterCount; j++)
+				{
+					const Parameter &p = parameters[j];
+					values[j] += std::normal_distribution<double>(0.0, spread * (p.max - p.min + p.step))(rng);
+				}
+				all.push_back(makeCandidate(base, values));
+			}
+		}
+
+		evaluateAll(all, evaluated, threads, runs, durationS, weights);
+		evaluated = all.size();
+		const Candidate &best = *std::min_element(all.begin(), all.end(), better);
+		fmt::print(stderr, "Round {}: {} candidates, best cost {:.4f} ({:.1f} s on {} threads)\n", round + 1, all.size(), best.cost,
+				   std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), threads);
+	}
+	std::stable_sort(all.begin(), all.end(), better);
+
+	// Ranking
+	fmt::print("rank,cost,averageRes,missedFrameRatio,changesPerMinute");
+	for (const Parameter &p : parameters)
+		fmt::print(",{}", p.name);
+	fmt::print(",baseline\n");
+	size_t baselineRank = 0;
+	for (size_t i = 0; i < all.size(); i++)
+	{
+		const Candidate &c = all[i];
+		if (c.baseline)
+			baselineRank = i + 1;
+		if (i >= args::get(top) && !c.baseline)
+			continue;
+		fmt::print("{},{:.4f},{:.3f},{:.4f},{:.2f}", i + 1, c.cost, c.averageRes, c.missedFrameRatio, c.changesPerMinute);
+		for (size_t j = 0; j < parameterCount; j++)
+			fmt::print(",{}", formatValue(parameters[j], c.values[j]));
+		fmt::print(",{}\n", c.baseline ? 1 : 0);
+	}
+	fmt::print(stderr, "{} ranks {} of {}\n", args::get(settingsPath), baselineRank, all.size());
+
+	// A best value on the edge of its range may only be the best of what was searched.
+	// Nothing below 0 is valid, so that edge is a real one.
+	const Candidate &best = all.front();
+	for (size_t i = 0; i < parameterCount; i++)
+	{
+		const Parameter &p = parameters[i];
+		if (p.max - p.min <= p.step)
+			continue;
+		double value = best.values[i];
+		if (value <= p.min && p.min > 0)
+			fmt::print(stderr, "{} of the best candidate is at the bottom of its range ({}), lower values weren't tried\n", p.name, formatValue(p, value));
+		else if (value >= p.max)
+			fmt::print(stderr, "{} of the best candidate is at the top of its range ({}), higher values weren't tried\n", p.name, formatValue(p, value));
+	}
+
+	std::string text;
+	if (!formatSettings(baseText, best.settings, text))
+	{
+		fmt::print(stderr, "Could not format the settings\n");
+		return 1;
+	}
+	std::string scenarioList;
+	for (const std::string &name : names)
+		scenarioList += (scenarioList.empty() ? "" : ", ") + name;
+	std::string header = fmt::format("; Tuned from {} against {} at {:g} Hz, {:g} s each with {} seeds\n"
+									 "; Cost {:.4f}: {:.0f}% average resolution, {:.2f}% missed frames, {:.1f} changes per minute\n",
+									 args::get(settingsPath), scenarioList, args::get(hz), durationS, std::max(args::get(seeds), 1u),
+									 best.cost, best.averageRes * 100, best.missedFrameRatio * 100, best.changesPerMinute);
+	std::ofstream file(args::get(output), std::ios::binary);
+	if (!(file << header << text))
+	{
+		fmt::print(stderr, "Could not write {}\n", args::get(output));
+		return 1;
+	}
+	fmt::print(stderr, "Wrote {}\n", args::get(output));
+	return 0;
+}
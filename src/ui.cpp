@@ -0,0 +1,138 @@
+#include "ui.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <curses.h>
+
+static bool headlessMode = false;
+
+void uiInit(bool headless)
+{
+	headlessMode = headless;
+	if (headless)
+		return;
+
+	initscr();						   // Initialize screen
+	cbreak();						   // Disable line-buffering (for input)
+	noecho();						   // Don't show what the user types
+	curs_set(0);					   // Hide the cursor
+	resize_term(uiRows, uiColumns);	   // Sets the initial (y, x) resolution
+}
+
+void uiEnd()
+{
+	if (!headlessMode)
+		endwin();
+}
+
+bool uiHeadless()
+{
+	return headlessMode;
+}
+
+void uiPrint(const char *text)
+{
+	if (headlessMode)
+	{
+		std::fputs(text, stdout);
+		std::fflush(stdout);
+		return;
+	}
+	printw("%s", text);
+	refresh();
+}
+
+void uiClear()
+{
+	if (headlessMode)
+		return;
+	clear();
+	refresh();
+}
+
+void uiWaitForKey(const std::atomic<bool> &stop)
+{
+	if (headlessMode)
+		return;
+	// Wakes up every 100 ms to see if we were asked to stop
+	timeout(100);
+	while (!stop && getch() == ERR)
+		;
+	timeout(-1);
+}
+
+UiThread::UiThread(const Seqlock<UiSnapshot> &snapshots, const char *version, int maxRate)
+	: snapshots(snapshots), version(version), maxRate(maxRate > 0 ? maxRate : 1)
+{
+}
+
+UiThread::~UiThread()
+{
+	stop();
+}
+
+void UiThread::start()
+{
+	if (headlessMode || running)
+		return;
+	running = true;
+	thread = std::thread(&UiThread::run, this);
+}
+
+void UiThread::stop()
+{
+	running = false;
+	if (thread.joinable())
+		thread.join();
+}
+
+void UiThread::run()
+{
+	const auto interval = std::chrono::microseconds(1000000 / maxRate);
+	uint64_t drawnVersion = 0;
+	UiSnapshot snapshot;
+	UiScreen next;
+
+	while (running)
+	{
+		auto frameStart = std::chrono::steady_clock::now();
+
+		// Only lay out the window again when the control loop published something new
+		uint64_t published = snapshots.version();
+		if (published != drawnVersion && snapshots.load(snapshot))
+		{
+			drawnVersion = published;
+			formatUi(snapshot, version, next);
+			draw(next);
+		}
+
+		std::this_thread::sleep_until(frameStart + interval);
+	}
+}
+
+void UiThread::draw(const UiScreen &next)
+{
+	bool changed = false;
+	for (int i = 0; i < uiRows; i++)
+	{
+		const UiRow &row = next[i];
+		if (!firstDraw && row.style == shown[i].style && std::strcmp(row.text, shown[i].text) == 0)
+			continue;
+
+		if (row.style == UiStyle::Underline)
+			attron(A_UNDERLINE);
+		else if (row.style == UiStyle::Bold)
+			attron(A_BOLD);
+		mvaddstr(i, 0, row.text);
+		attroff(A_UNDERLINE | A_BOLD);
+		clrtoeol();
+
+		shown[i] = row;
+		changed = true;
+	}
+	firstDraw = false;
+
+	if (changed)
+		refresh();
+}
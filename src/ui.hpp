@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "seqlock.hpp"
+#include "uiformat.hpp"
+
+// Console output. In headless mode curses is never initialized and
+// messages go to stdout instead.
+void uiInit(bool headless);
+void uiEnd();
+bool uiHeadless();
+
+// Startup messages, printed before the UI thread takes over the window
+void uiPrint(const char *text);
+void uiClear();
+// Waits for a key press, or until stop is set. Returns right away when headless.
+void uiWaitForKey(const std::atomic<bool> &stop);
+
+// Draws the snapshots published by the control loop on its own thread.
+// Redraws at most maxRate times per second, and only the rows whose text changed.
+class UiThread
+{
+public:
+	UiThread(const Seqlock<UiSnapshot> &snapshots, const char *version, int maxRate);
+	~UiThread();
+
+	void start();
+	void stop();
+
+private:
+	void run();
+	void draw(const UiScreen &next);
+
+	const Seqlock<UiSnapshot> &snapshots;
+	const char *version;
+	int maxRate;
+
+	UiScreen shown{};
+	bool firstDraw = true;
+	std::atomic<bool> running{false};
+	std::thread thread;
+};
@@ -0,0 +1,203 @@
+#include "uiformat.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+
+#include "reprojection.hpp"
+#include "thermal.hpp"
+
+// Formats into a row, truncated to the width of the window
+template <typename... Args>
+static void setRow(UiRow &row, UiStyle style, fmt::format_string<Args...> format, Args &&...args)
+{
+	auto result = fmt::format_to_n(row.text, uiColumns, format, std::forward<Args>(args)...);
+	row.text[std::min<size_t>(result.size, uiColumns)] = '\0';
+	row.style = style;
+}
+
+// First four characters of the default float formatting, e.g. 11.1 or 8.33
+struct Short
+{
+	char text[16];
+
+	explicit Short(float value)
+	{
+		auto result = fmt::format_to_n(text, sizeof(text) - 1, "{:f}", value);
+		text[std::min<size_t>(result.size, 4)] = '\0';
+	}
+};
+
+void formatUi(const UiSnapshot &s, const char *version, UiScreen &screen)
+{
+	for (UiRow &row : screen)
+	{
+		row.text[0] = '\0';
+		row.style = UiStyle::Normal;
+	}
+
+	// Title
+	setRow(screen[0], UiStyle::Underline, "OpenVR Dynamic Resolution {}{}", version, s.simulated ? " (simulated)" : "");
+
+	// Settings status
+	setRow(screen[1], UiStyle::Normal, "{}", s.settingsStatus);
+
+	// Trace recording status
+	if (s.recording)
+		setRow(screen[2], UiStyle::Normal, "Recording to {} ({} dropped)", s.traceFile, s.droppedRecords);
+
+	// HMD Hz
+	setRow(screen[3], UiStyle::Normal, "HMD Hz: {} fps", int(s.displayHz));
+
+	// Target frametime
+	if (!s.vramOnlyMode)
+	{
+		setRow(screen[4], UiStyle::Normal, "HMD Hz target frametime: {} ms", Short(s.realTargetFrametime).text);
+		setRow(screen[5], UiStyle::Normal, "Adjusted target frametime: {} ms ({} rate)", Short(s.targetFrametime).text, rateModeName(s.rateMode));
+	}
+	else
+	{
+		setRow(screen[4], UiStyle::Normal, "Adjusted target frametime: Disabled");
+		setRow(screen[5], UiStyle::Normal, "HMD Hz target frametime: Disabled");
+	}
+
+	// VRAM target and limit
+	if (s.vramMonitorEnabled)
+	{
+		setRow(screen[6], UiStyle::Normal, "VRAM target: {}%", Short(s.vramTarget * 100).text);
+		setRow(screen[7], UiStyle::Normal, "VRAM limit: {}%", Short(s.vramLimit * 100).text);
+	}
+	else
+	{
+		setRow(screen[6], UiStyle::Normal, "VRAM target: Disabled");
+		setRow(screen[7], UiStyle::Normal, "VRAM limit: Disabled");
+	}
+
+	// Wakeups of the control loop
+	setRow(screen[8], UiStyle::Normal, "Polling: {:.1f} Hz ({})", s.pollRate, pollStateName(s.pollState));
+
+	// FPS and frametimes
+	setRow(screen[9], UiStyle::Normal, "FPS: {} fps", s.currentFps);
+	setRow(screen[10], UiStyle::Normal, "GPU frametime: {} ms", Short(s.averageGpuTime).text);
+	setRow(screen[11], UiStyle::Normal, "GPU p50/p95/p99: {:.2f} / {:.2f} / {:.2f} ms", s.gpuPercentiles[0], s.gpuPercentiles[1], s.gpuPercentiles[2]);
+	setRow(screen[12], UiStyle::Normal, "CPU frametime: {} ms", Short(s.averageCpuTime).text);
+	setRow(screen[13], UiStyle::Normal, "CPU p50/p95/p99: {:.2f} / {:.2f} / {:.2f} ms", s.cpuPercentiles[0], s.cpuPercentiles[1], s.cpuPercentiles[2]);
+	setRow(screen[14], UiStyle::Normal, "Raw CPU frametime: {} ms", Short(s.rawCpuTime).text);
+
+	// Sensors and throttling
+	if (s.thermalRead)
+	{
+		char sensors[uiColumns];
+		describeThermal(s.thermal, sensors, sizeof(sensors));
+		setRow(screen[15], UiStyle::Normal, "Thermal: {}", sensors);
+		if (s.throttling)
+		{
+			char reasons[40];
+			describeThrottle(s.throttleReasons, reasons, sizeof(reasons));
+			setRow(screen[16], UiStyle::Normal, "Throttling: Yes for {:.0f} s ({}), max {}%", s.throttleSeconds,
+				   s.throttleReasons ? reasons : "cooling down", int(s.throttleCeiling * 100));
+		}
+		else
+		{
+			setRow(screen[16], UiStyle::Normal, "Throttling: No ({} times so far)", s.throttleEvents);
+		}
+	}
+	else if (s.thermalMonitorEnabled)
+	{
+		setRow(screen[15], UiStyle::Normal, "Thermal: Unavailable");
+	}
+	else
+	{
+		setRow(screen[15], UiStyle::Normal, "Thermal: Disabled");
+	}
+
+	// VRAM usage
+	if (s.vramRead && s.appVramKnown)
+		setRow(screen[17], UiStyle::Normal, "VRAM usage: {}% (game: {:.1f} GB)", Short(s.vramUsage * 100).text, s.appVramBytes / 1073741824.0);
+	else if (s.vramRead)
+		setRow(screen[17], UiStyle::Normal, "VRAM usage: {}%", Short(s.vramUsage * 100).text);
+	else if (s.vramMonitorEnabled)
+		setRow(screen[17], UiStyle::Normal, "VRAM usage: Unavailable");
+	else
+		setRow(screen[17], UiStyle::Normal, "VRAM usage: Disabled");
+
+	// Reprojecting status
+	if (s.frameShown > 1)
+	{
+		char reason[40];
+		describeReprojection(decodeReprojection(s.reprojectionFlags), reason, sizeof(reason));
+		setRow(screen[19], UiStyle::Normal, "Reprojecting: Yes ({}x, {})", s.frameShown, reason);
+	}
+	else
+	{
+		setRow(screen[19], UiStyle::Normal, "Reprojecting: No");
+	}
+	setRow(screen[20], UiStyle::Normal, "Late: CPU {:.0f}% GPU {:.0f}% Throttled {:.0f}% Smoothed {:.0f}%{}",
+		   s.cpuLimitedShare * 100, s.gpuLimitedShare * 100, s.throttledShare * 100, s.motionSmoothedShare * 100,
+		   s.cpuBound ? " (CPU-bound)" : "");
+
+	// Current resolution
+	setRow(screen[21], UiStyle::Bold, "Resolution = {}%", int(s.res * 100));
+
+	// GPU cost model fit
+	if (s.modelEnabled)
+	{
+		if (s.modelReady)
+			setRow(screen[22], UiStyle::Normal, "Model: {:.2f} ms fixed + {:.2f} ms/Mpixel", s.modelFixedMs, s.modelMsPerMpixel);
+		else
+			setRow(screen[22], UiStyle::Normal, "Model: Learning");
+	}
+
+	// Application profile
+	if (s.appKey[0])
+	{
+		if (s.warmStartRes > 0)
+			setRow(screen[23], UiStyle::Normal, "App: {} (started at {}%)", s.appKey, int(s.warmStartRes * 100));
+		else
+			setRow(screen[23], UiStyle::Normal, "App: {}", s.appKey);
+	}
+
+	// What resolution changes cost
+	if (s.hitchSamples > 0)
+		setRow(screen[24], UiStyle::Normal, "Change hitch: {:.1f} frames, +{:.1f} ms, {:.0f} ms ({} skipped)",
+			   s.hitchFrames, s.hitchSpikeMs, s.hitchRecoveryMs, s.skippedChanges);
+	else
+		setRow(screen[24], UiStyle::Normal, "Change hitch: Not measured yet");
+
+	// Early decreases from the GPU frametime trend
+	if (s.predictionEnabled)
+		setRow(screen[25], UiStyle::Normal, "GPU trend: {:+.2f} ms/s, {} early cuts ({} right, {} wrong)",
+			   s.gpuTrendPerSecond, s.predictionsFired, s.predictionsConfirmed, s.predictionsMissed);
+
+	// Native/half rate mode
+	if (!s.vramOnlyMode)
+	{
+		if (s.nativeResEstimate > 0)
+			setRow(screen[26], UiStyle::Normal, "Rate: {} for {:.0f} s ({} switches), native {}% half {}%", rateModeName(s.rateMode),
+				   s.rateModeSeconds, s.rateModeSwitches, int(s.nativeResEstimate * 100), int(s.halfResEstimate * 100));
+		else
+			setRow(screen[26], UiStyle::Normal, "Rate: {} for {:.0f} s ({} switches)", rateModeName(s.rateMode), s.rateModeSeconds, s.rateModeSwitches);
+	}
+
+	// Frame pipeline
+	auto stage = [&](Stage stage)
+	{ return Short(s.stageAverages[size_t(stage)]); };
+	setRow(screen[27], UiStyle::Normal, "CPU app {} / compositor {} / idle {} ms (app p99 {})", stage(Stage::AppCpu).text,
+		   stage(Stage::CompositorCpu).text, stage(Stage::CompositorIdle).text, Short(s.appCpuP99).text);
+	setRow(screen[28], UiStyle::Normal, "GPU pre-submit {} / post-submit {} / compositor {} ms", stage(Stage::PreSubmitGpu).text,
+		   stage(Stage::PostSubmitGpu).text, stage(Stage::CompositorGpu).text);
+	setRow(screen[29], UiStyle::Normal, "Submit {} / wait {} / interval {} ms, drop {} mispresent {}", stage(Stage::Submit).text,
+		   stage(Stage::WaitForPresent).text, stage(Stage::ClientFrameInterval).text, s.droppedFrames, s.misPresentedFrames);
+
+	// What the frames were tagged with
+	auto share = [&](SessionState state)
+	{ return int(s.sessionShares[size_t(state)] * 100); };
+	setRow(screen[30], UiStyle::Normal, "Session: {} (dash {}% load {}% switch {}%), {} outliers", sessionStateName(s.sessionState),
+		   share(SessionState::Dashboard), share(SessionState::Loading), share(SessionState::Transition), s.outlierFrames);
+
+	// Startup
+	if (s.simulated)
+		setRow(screen[31], UiStyle::Normal, "Started in {:.0f} ms", s.startupMs);
+	else
+		setRow(screen[31], UiStyle::Normal, "Started in {:.0f} ms (SteamVR after {:.0f} ms, {} tries) {}", s.startupMs,
+			   s.steamVrWaitMs, s.initAttempts, s.autoStartStatus);
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "pipeline.hpp"
+#include "ratemode.hpp"
+#include "scheduler.hpp"
+#include "session.hpp"
+#include "thermal.hpp"
+
+// Size of the window
+static constexpr int uiRows = 32;
+static constexpr int uiColumns = 64;
+
+// Everything the window shows, published by the control loop once per tick
+struct UiSnapshot
+{
+	bool simulated = false;
+	char settingsStatus[uiColumns] = "";
+	// Time from launch to the first tick, and to SteamVR being up
+	float startupMs = 0.0f;
+	float steamVrWaitMs = 0.0f;
+	int initAttempts = 0;
+	char autoStartStatus[uiColumns] = "";
+	bool vramOnlyMode = false;
+	bool vramMonitorEnabled = false;
+
+	bool recording = false;
+	char traceFile[48] = "";
+	uint64_t droppedRecords = 0;
+
+	float displayHz = 0.0f;
+	float realTargetFrametime = 0.0f;
+	float targetFrametime = 0.0f;
+	float vramTarget = 0.0f;
+	float vramLimit = 0.0f;
+
+	float pollRate = 0.0f;
+	PollState pollState = PollState::Active;
+
+	uint32_t currentFps = 0;
+	float averageGpuTime = 0.0f;
+	float gpuPercentiles[3] = {};
+	float averageCpuTime = 0.0f;
+	float cpuPercentiles[3] = {};
+	float rawCpuTime = 0.0f;
+
+	bool vramRead = false;
+	float vramUsage = 0.0f;
+	bool appVramKnown = false;
+	uint64_t appVramBytes = 0;
+
+	// Sensors, and whether the hardware is throttling
+	bool thermalMonitorEnabled = false;
+	bool thermalRead = false;
+	ThermalSample thermal;
+	bool throttling = false;
+	uint32_t throttleReasons = 0;
+	float throttleSeconds = 0.0f;
+	uint64_t throttleEvents = 0;
+	float throttleCeiling = 0.0f;
+
+	// How many times the latest frame was shown (>1 = reprojecting)
+	uint32_t frameShown = 1;
+	uint32_t reprojectionFlags = 0;
+	// Why the recent frames were reprojected (shares of the averaging window)
+	float cpuLimitedShare = 0.0f;
+	float gpuLimitedShare = 0.0f;
+	float throttledShare = 0.0f;
+	float motionSmoothedShare = 0.0f;
+	bool cpuBound = false;
+
+	float res = 0.0f;
+
+	bool modelEnabled = false;
+	bool modelReady = false;
+	float modelFixedMs = 0.0f;
+	float modelMsPerMpixel = 0.0f;
+
+	char appKey[64] = "";
+	float warmStartRes = 0.0f;
+
+	// Running estimate of what a resolution change costs
+	float hitchFrames = 0.0f;
+	float hitchSpikeMs = 0.0f;
+	float hitchRecoveryMs = 0.0f;
+	uint32_t hitchSamples = 0;
+	uint64_t skippedChanges = 0;
+
+	// GPU frametime trend and the early decreases it caused
+	bool predictionEnabled = false;
+	float gpuTrendPerSecond = 0.0f;
+	uint64_t predictionsFired = 0;
+	uint64_t predictionsConfirmed = 0;
+	uint64_t predictionsMissed = 0;
+
+	// Native or half rate, and the resolution each could sustain
+	RateMode rateMode = RateMode::Native;
+	float rateModeSeconds = 0.0f;
+	uint64_t rateModeSwitches = 0;
+	float nativeResEstimate = 0.0f;
+	float halfResEstimate = 0.0f;
+
+	// Average of each stage of the frames, indexed by Stage
+	float stageAverages[stageCount] = {};
+	float appCpuP99 = 0.0f;
+	uint64_t droppedFrames = 0;
+	uint64_t misPresentedFrames = 0;
+
+	// State of the session, the share of the frames each state got, and the in-app frames left out
+	SessionState sessionState = SessionState::InApp;
+	float sessionShares[sessionStateCount] = {};
+	uint64_t outlierFrames = 0;
+};
+
+enum class UiStyle : uint8_t
+{
+	Normal,
+	Underline,
+	Bold,
+};
+
+struct UiRow
+{
+	char text[uiColumns + 1] = "";
+	UiStyle style = UiStyle::Normal;
+};
+
+using UiScreen = std::array<UiRow, uiRows>;
+
+// Lays out the window for a snapshot, without allocating
+void formatUi(const UiSnapshot &snapshot, const char *version, UiScreen &screen);
+
+// Copies a string into a fixed-size field, truncating it if needed
+template <size_t N>
+void copyField(char (&field)[N], const char *text)
+{
+	size_t i = 0;
+	for (; i + 1 < N && text[i]; i++)
+		field[i] = text[i];
+	field[i] = '\0';
+}
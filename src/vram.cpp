@@ -0,0 +1,197 @@
+#include "vram.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// How often the DRM file descriptors of a process are looked up again
+static constexpr std::chrono::seconds fdinfoRescanInterval(5);
+// How often they're read, about as often as the window shows the result
+static constexpr std::chrono::milliseconds fdinfoReadInterval(100);
+// Descriptors kept without growing the list during a rescan
+static constexpr size_t fdinfoReserve = 64;
+
+SysfsVramProvider::SysfsVramProvider(const std::string &root) : root(root), procRoot(sysfsPath(root, "/proc/"))
+{
+	fdinfos.reserve(fdinfoReserve);
+	clientIds.reserve(fdinfoReserve);
+
+	// Pick the card with the most VRAM, which is the discrete GPU on hybrid systems
+	std::error_code ec;
+	for (const fs::directory_entry &entry : fs::directory_iterator(sysfsPath(root, "/sys/class/drm"), ec))
+	{
+		std::string card = entry.path().filename().string();
+		if (card.compare(0, 4, "card") != 0 || card.size() == 4 ||
+			card.find_first_not_of("0123456789", 4) != std::string::npos)
+			continue;
+
+		uint64_t total = 0;
+		std::string device = entry.path().string() + "/device/";
+		if (!readSysfsUint64(device + "mem_info_vram_total", total) || total <= totalBytes)
+			continue;
+
+		SysfsFile file;
+		if (!file.open(device + "mem_info_vram_used"))
+			continue;
+
+		used = std::move(file);
+		totalBytes = total;
+		cardName = card;
+	}
+}
+
+bool SysfsVramProvider::read(VramInfo &info)
+{
+	uint64_t usedBytes = 0;
+	if (!used.readUint64(usedBytes))
+		return false;
+	info.usedBytes = usedBytes;
+	info.totalBytes = totalBytes;
+	return true;
+}
+
+void SysfsVramProvider::scanFdinfo(uint32_t pid)
+{
+	fdinfos.clear();
+	fdinfoPid = pid;
+	fdinfoScanTime = std::chrono::steady_clock::now();
+
+#ifdef __linux__
+	// Paths are built in place so that the periodic rescan doesn't allocate
+	char path[4096];
+	int dirLength = std::snprintf(path, sizeof(path), "%s%u/fdinfo/", procRoot.c_str(), pid);
+	if (dirLength <= 0 || size_t(dirLength) >= sizeof(path))
+		return;
+
+	DIR *dir = opendir(path);
+	if (!dir)
+		return;
+	while (const dirent *entry = readdir(dir))
+	{
+		if (entry->d_name[0] == '.')
+			continue;
+		size_t nameLength = std::strlen(entry->d_name);
+		if (size_t(dirLength) + nameLength >= sizeof(path))
+			continue;
+		std::memcpy(path + dirLength, entry->d_name, nameLength + 1);
+
+		// Only keep the descriptors that are DRM clients
+		SysfsFile file;
+		char text[4096];
+		uint64_t clientId, vramBytes;
+		if (file.open(path) && file.read(text, sizeof(text)) > 0 &&
+			parseDrmFdinfo(text, clientId, vramBytes))
+			fdinfos.push_back(std::move(file));
+	}
+	closedir(dir);
+#endif
+}
+
+bool SysfsVramProvider::processUsage(uint32_t pid, uint64_t &bytes)
+{
+	if (pid == 0)
+		return false;
+	auto now = std::chrono::steady_clock::now();
+	if (pid == fdinfoPid && now - fdinfoReadTime < fdinfoReadInterval)
+	{
+		bytes = processBytes;
+		return processKnown;
+	}
+	if (pid != fdinfoPid || now - fdinfoScanTime > fdinfoRescanInterval)
+		scanFdinfo(pid);
+	fdinfoReadTime = now;
+
+	// Descriptors duplicated from the same client report the same memory
+	clientIds.clear();
+	processBytes = 0;
+	processKnown = false;
+	for (const SysfsFile &file : fdinfos)
+	{
+		char text[4096];
+		uint64_t clientId, vramBytes;
+		if (file.read(text, sizeof(text)) <= 0 || !parseDrmFdinfo(text, clientId, vramBytes))
+			continue;
+		processKnown = true;
+		if (std::find(clientIds.begin(), clientIds.end(), clientId) != clientIds.end())
+			continue;
+		clientIds.push_back(clientId);
+		processBytes += vramBytes;
+	}
+	bytes = processBytes;
+	return processKnown;
+}
+
+// Parses "<value> [KiB|MiB|GiB]" into bytes
+static uint64_t parseFdinfoSize(const char *text)
+{
+	char *end = nullptr;
+	uint64_t value = std::strtoull(text, &end, 10);
+	while (*end == ' ' || *end == '\t')
+		end++;
+	if (std::strncmp(end, "KiB", 3) == 0)
+		value <<= 10;
+	else if (std::strncmp(end, "MiB", 3) == 0)
+		value <<= 20;
+	else if (std::strncmp(end, "GiB", 3) == 0)
+		value <<= 30;
+	return value;
+}
+
+bool parseDrmFdinfo(const char *text, uint64_t &clientId, uint64_t &vramBytes)
+{
+	bool isClient = false;
+	bool hasResident = false;
+	clientId = 0;
+	vramBytes = 0;
+
+	for (const char *line = text; *line; )
+	{
+		const char *next = std::strchr(line, '\n');
+		const char *colon = std::strchr(line, ':');
+		if (colon && (!next || colon < next))
+		{
+			size_t keyLength = size_t(colon - line);
+			const char *value = colon + 1;
+			while (*value == ' ' || *value == '\t')
+				value++;
+
+			if (keyLength == 13 && std::strncmp(line, "drm-client-id", keyLength) == 0)
+			{
+				clientId = std::strtoull(value, nullptr, 10);
+				isClient = true;
+			}
+			else if (keyLength == 17 && std::strncmp(line, "drm-resident-vram", keyLength) == 0)
+			{
+				// Current name of the key
+				vramBytes = parseFdinfoSize(value);
+				hasResident = true;
+			}
+			else if (keyLength == 15 && std::strncmp(line, "drm-memory-vram", keyLength) == 0 && !hasResident)
+			{
+				// Name used by amdgpu before the keys were standardized
+				vramBytes = parseFdinfoSize(value);
+			}
+		}
+		if (!next)
+			break;
+		line = next + 1;
+	}
+	return isClient;
+}
+
+std::unique_ptr<VramProvider> createVramProvider(const std::string &sysfsRoot)
+{
+#ifdef __linux__
+	auto sysfs = std::make_unique<SysfsVramProvider>(sysfsRoot);
+	if (sysfs->valid())
+		return sysfs;
+#endif
+	return std::make_unique<NullVramProvider>();
+}
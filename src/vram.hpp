@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sysfs.hpp"
+
+struct VramInfo
+{
+	uint64_t usedBytes = 0;
+	uint64_t totalBytes = 0;
+
+	float usage() const { return totalBytes > 0 ? float(double(usedBytes) / double(totalBytes)) : 0.0f; }
+};
+
+// Source of the VRAM usage fed to the controller
+class VramProvider
+{
+public:
+	virtual ~VramProvider() = default;
+
+	virtual const char *name() const = 0;
+	// Device-wide usage, false if it couldn't be read
+	virtual bool read(VramInfo &info) = 0;
+	// VRAM held by one process through its DRM file descriptors, false if unknown
+	virtual bool processUsage(uint32_t /*pid*/, uint64_t & /*bytes*/) { return false; }
+};
+
+// No VRAM information on this platform
+class NullVramProvider : public VramProvider
+{
+public:
+	const char *name() const override { return "none"; }
+	bool read(VramInfo & /*info*/) override { return false; }
+};
+
+// amdgpu through sysfs (mem_info_vram_used/total) and DRM fdinfo for per-process usage.
+// Every path is looked up under root, so a fake directory tree can stand in for the real one.
+class SysfsVramProvider : public VramProvider
+{
+public:
+	explicit SysfsVramProvider(const std::string &root);
+
+	// Whether a card exposing its VRAM was found
+	bool valid() const { return used.isOpen() && totalBytes > 0; }
+
+	const char *name() const override { return cardName.c_str(); }
+	bool read(VramInfo &info) override;
+	bool processUsage(uint32_t pid, uint64_t &bytes) override;
+
+private:
+	void scanFdinfo(uint32_t pid);
+
+	std::string root;
+	std::string procRoot;
+	std::string cardName;
+	SysfsFile used;
+	uint64_t totalBytes = 0;
+
+	// DRM file descriptors of the last process asked about
+	uint32_t fdinfoPid = 0;
+	std::chrono::steady_clock::time_point fdinfoScanTime;
+	std::vector<SysfsFile> fdinfos;
+	std::vector<uint64_t> clientIds;
+	// Its usage as of the last read of the descriptors
+	std::chrono::steady_clock::time_point fdinfoReadTime;
+	bool processKnown = false;
+	uint64_t processBytes = 0;
+};
+
+// Parses a DRM fdinfo file. Returns false if it doesn't belong to a DRM client.
+bool parseDrmFdinfo(const char *text, uint64_t &clientId, uint64_t &vramBytes);
+
+// The best provider available for this platform, or a NullVramProvider
+std::unique_ptr<VramProvider> createVramProvider(const std::string &sysfsRoot);
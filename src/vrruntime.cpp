@@ -0,0 +1,182 @@
+#include "vrruntime.hpp"
+
+#include <algorithm>
+
+#include "reprojection.hpp"
+
+// How often every cached property is read again, in case an event was missed
+static constexpr auto fullReadInterval = std::chrono::seconds(5);
+
+// The frames keep the flags as OpenVR reports them
+static_assert(reprojectionReasonCpu == vr::VRCompositor_ReprojectionReason_Cpu);
+static_assert(reprojectionReasonGpu == vr::VRCompositor_ReprojectionReason_Gpu);
+static_assert(reprojectionAsync == vr::VRCompositor_ReprojectionAsync);
+static_assert(reprojectionMotion == vr::VRCompositor_ReprojectionMotion);
+static_assert(reprojectionPredictionMask == vr::VRCompositor_PredictionMask);
+static_assert(reprojectionThrottleMask == vr::VRCompositor_ThrottleMask);
+
+FrameSample toFrameSample(const vr::Compositor_FrameTiming &timing)
+{
+	FrameSample sample;
+	sample.frameIndex = timing.m_nFrameIndex;
+	sample.numFramePresents = timing.m_nNumFramePresents;
+	sample.numMisPresented = timing.m_nNumMisPresented;
+	sample.numDroppedFrames = timing.m_nNumDroppedFrames;
+	sample.reprojectionFlags = timing.m_nReprojectionFlags;
+	sample.systemTimeInSeconds = timing.m_flSystemTimeInSeconds;
+	sample.preSubmitGpuMs = timing.m_flPreSubmitGpuMs;
+	sample.postSubmitGpuMs = timing.m_flPostSubmitGpuMs;
+	sample.totalRenderGpuMs = timing.m_flTotalRenderGpuMs;
+	sample.compositorRenderGpuMs = timing.m_flCompositorRenderGpuMs;
+	sample.compositorRenderCpuMs = timing.m_flCompositorRenderCpuMs;
+	sample.compositorIdleCpuMs = timing.m_flCompositorIdleCpuMs;
+	sample.clientFrameIntervalMs = timing.m_flClientFrameIntervalMs;
+	sample.presentCallCpuMs = timing.m_flPresentCallCpuMs;
+	sample.waitForPresentCpuMs = timing.m_flWaitForPresentCpuMs;
+	sample.submitFrameMs = timing.m_flSubmitFrameMs;
+	sample.waitGetPosesCalledMs = timing.m_flWaitGetPosesCalledMs;
+	sample.newPosesReadyMs = timing.m_flNewPosesReadyMs;
+	sample.newFrameReadyMs = timing.m_flNewFrameReadyMs;
+	sample.compositorUpdateStartMs = timing.m_flCompositorUpdateStartMs;
+	sample.compositorUpdateEndMs = timing.m_flCompositorUpdateEndMs;
+	sample.compositorRenderStartMs = timing.m_flCompositorRenderStartMs;
+	sample.numVSyncsReadyForUse = timing.m_nNumVSyncsReadyForUse;
+	sample.numVSyncsToFirstView = timing.m_nNumVSyncsToFirstView;
+	return sample;
+}
+
+OpenVrRuntime::OpenVrRuntime()
+	: actuator([this](float res)
+			   {
+				   timeCall(ipc, IpcCall::SetSupersampleScale, [&]
+							{ vr::VRSettings()->SetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float, res); });
+			   })
+{
+	readAll();
+}
+
+void OpenVrRuntime::pollEvents()
+{
+	vr::VREvent_t event;
+	while (timeCall(ipc, IpcCall::PollEvents, [&]
+					{ return vr::VRSystem()->PollNextEvent(&event, sizeof(event)); }))
+	{
+		switch (event.eventType)
+		{
+		case vr::VREvent_PropertyChanged:
+			if (event.trackedDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd && event.data.property.prop == vr::Prop_DisplayFrequency_Float)
+				readDisplayFrequency();
+			break;
+		case vr::VREvent_DashboardActivated:
+			dashboardVisible = true;
+			break;
+		case vr::VREvent_DashboardDeactivated:
+			dashboardVisible = false;
+			break;
+		case vr::VREvent_SceneApplicationChanged:
+			readSceneProcessId();
+			break;
+		case vr::VREvent_SteamVRSectionSettingChanged:
+			// Our own writes land here too; while one is still on its way, what we asked for is more recent
+			if (actuator.idle())
+				readSupersampleScale();
+			break;
+		case vr::VREvent_Quit:
+			// SteamVR waits a few seconds for us otherwise
+			vr::VRSystem()->AcknowledgeQuit_Exiting();
+			quit = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	// In case an event was missed
+	if (std::chrono::steady_clock::now() - lastFullRead > fullReadInterval)
+		readAll();
+}
+
+bool OpenVrRuntime::getFrameTiming(FrameSample &frame)
+{
+	vr::Compositor_FrameTiming timing{};
+	timing.m_nSize = sizeof(vr::Compositor_FrameTiming);
+	if (!timeCall(ipc, IpcCall::FrameTimings, [&]
+				  { return vr::VRCompositor()->GetFrameTiming(&timing, 0); }))
+		return false;
+	frame = toFrameSample(timing);
+	return true;
+}
+
+uint32_t OpenVrRuntime::getFrameTimings(FrameSample *frames, uint32_t count)
+{
+	count = std::min<uint32_t>(count, uint32_t(timings.size()));
+
+	// Only the first entry's size needs to be set, the rest are inferred from it
+	timings[0].m_nSize = sizeof(vr::Compositor_FrameTiming);
+	uint32_t fetched = timeCall(ipc, IpcCall::FrameTimings, [&]
+								{ return vr::VRCompositor()->GetFrameTimings(timings.data(), count); });
+	for (uint32_t i = 0; i < fetched; i++)
+		frames[i] = toFrameSample(timings[i]);
+	return fetched;
+}
+
+void OpenVrRuntime::setSupersampleScale(float res)
+{
+	supersampleScale = res;
+	renderSizeStale = true;
+	actuator.submit(res);
+}
+
+void OpenVrRuntime::getRecommendedRenderTargetSize(uint32_t &width, uint32_t &height)
+{
+	// The size follows the supersample scale once vrserver has it
+	if (renderSizeStale && actuator.idle())
+	{
+		timeCall(ipc, IpcCall::RenderTargetSize, [&]
+				 { vr::VRSystem()->GetRecommendedRenderTargetSize(&renderWidth, &renderHeight); });
+		renderSizeStale = false;
+	}
+	width = renderWidth;
+	height = renderHeight;
+}
+
+bool OpenVrRuntime::getApplicationKey(uint32_t pid, char *key, uint32_t size)
+{
+	return timeCall(ipc, IpcCall::ApplicationKey, [&]
+					{ return vr::VRApplications()->GetApplicationKeyByProcessId(pid, key, size); }) == vr::VRApplicationError_None;
+}
+
+void OpenVrRuntime::readSupersampleScale()
+{
+	supersampleScale = timeCall(ipc, IpcCall::GetSupersampleScale, []
+								{ return vr::VRSettings()->GetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float); });
+	renderSizeStale = true;
+}
+
+void OpenVrRuntime::readDisplayFrequency()
+{
+	displayFrequency = timeCall(ipc, IpcCall::DisplayFrequency, []
+								{ return vr::VRSystem()->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float); });
+}
+
+void OpenVrRuntime::readDashboardVisible()
+{
+	dashboardVisible = timeCall(ipc, IpcCall::DashboardVisible, []
+								{ return vr::VROverlay()->IsDashboardVisible(); });
+}
+
+void OpenVrRuntime::readSceneProcessId()
+{
+	sceneProcessId = timeCall(ipc, IpcCall::SceneProcessId, []
+							  { return vr::VRApplications()->GetCurrentSceneProcessId(); });
+}
+
+void OpenVrRuntime::readAll()
+{
+	if (actuator.idle())
+		readSupersampleScale();
+	readDisplayFrequency();
+	readDashboardVisible();
+	readSceneProcessId();
+	lastFullRead = std::chrono::steady_clock::now();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <openvr.h>
+#include <array>
+#include <chrono>
+
+#include "actuator.hpp"
+#include "runtime.hpp"
+
+// Copies the fields of a compositor frame into the controller's representation
+FrameSample toFrameSample(const vr::Compositor_FrameTiming &timing);
+
+// Runtime backed by the OpenVR interfaces (VR_Init must have succeeded).
+// Every call is an IPC round-trip to vrserver, so the slow-changing properties
+// are cached and only read again when an event says they changed. Resolution
+// writes go through an actuator thread, and every call's latency is recorded.
+class OpenVrRuntime : public Runtime
+{
+public:
+	OpenVrRuntime();
+
+	void pollEvents() override;
+	const IpcStats *ipcStats() const override { return &ipc; }
+	uint64_t coalescedWrites() const override { return actuator.coalesced(); }
+	bool quitRequested() const override { return quit; }
+
+	bool getFrameTiming(FrameSample &frame) override;
+	uint32_t getFrameTimings(FrameSample *frames, uint32_t count) override;
+
+	float getSupersampleScale() override { return supersampleScale; }
+	void setSupersampleScale(float res) override;
+
+	void getRecommendedRenderTargetSize(uint32_t &width, uint32_t &height) override;
+	float getDisplayFrequency() override { return displayFrequency; }
+	bool isDashboardVisible() override { return dashboardVisible; }
+	uint32_t getSceneProcessId() override { return sceneProcessId; }
+	bool getApplicationKey(uint32_t pid, char *key, uint32_t size) override;
+
+private:
+	void readSupersampleScale();
+	void readDisplayFrequency();
+	void readDashboardVisible();
+	void readSceneProcessId();
+	void readAll();
+
+	IpcStats ipc;
+	std::array<vr::Compositor_FrameTiming, 128> timings{};
+
+	float supersampleScale = 1.0f;
+	float displayFrequency = 0.0f;
+	bool dashboardVisible = false;
+	uint32_t sceneProcessId = 0;
+	bool quit = false;
+	uint32_t renderWidth = 0;
+	uint32_t renderHeight = 0;
+	// The render target size has to be read again once the last resolution write went through
+	bool renderSizeStale = true;
+	std::chrono::steady_clock::time_point lastFullRead;
+
+	// Declared last, so its thread stops before the rest goes away
+	Actuator actuator;
+};